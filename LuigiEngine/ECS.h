@@ -1,118 +1,710 @@
 #pragma once
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
-using namespace std;
+#include "ThreadPool.hpp"
 
-const uint32_t MAX_ENTITIES = 1024; //ne pas mettre valeur max uint32 utilser au maximum max(uint32) -1
-const uint32_t INVALID = MAX_ENTITIES - 1; //permet de savoir si un composant est valide (contient un composant pour une certaine entity)
+using namespace std;
 
+//une entity est un handle 32 bits : les 20 bits de poids faible donnent l'index, les 12 bits de poids fort la generation
+//la generation est incrementee a chaque destroy, un ancien handle vers un index recycle n'est donc plus valide
 using Entity = uint32_t;
 
+const uint32_t ENTITY_INDEX_BITS = 20;
+const uint32_t ENTITY_INDEX_MASK = (1u << ENTITY_INDEX_BITS) - 1;
+const uint32_t ENTITY_GENERATION_MASK = (1u << (32 - ENTITY_INDEX_BITS)) - 1;
+
+const uint32_t MAX_ENTITIES = ENTITY_INDEX_MASK; //nombre max d'index, le dernier index est reserve pour INVALID
+const Entity INVALID = 0xFFFFFFFF; //entity nulle, sert aussi de valeur vide dans le sparse
+
+const uint32_t SPARSE_PAGE_SIZE = 4096; //nombre d'entrees par page du sparse (alloue a la demande)
+
+inline uint32_t entityIndex(Entity entity) { return entity & ENTITY_INDEX_MASK; }
+inline uint32_t entityGeneration(Entity entity) { return entity >> ENTITY_INDEX_BITS; }
+inline Entity makeEntity(uint32_t index, uint32_t generation) { return (generation << ENTITY_INDEX_BITS) | index; }
+
+//identifiant unique par type de composant, attribue a la premiere utilisation
+inline atomic<uint32_t> & componentTypeCounter(){ static atomic<uint32_t> counter{0}; return counter; } //atomique : des types peuvent etre vus pour la premiere fois depuis plusieurs threads
+
+template<typename Component>
+uint32_t componentTypeID(){
+    static const uint32_t id = componentTypeCounter()++;
+    return id;
+}
+
+//facon de stocker un type de composant :
+// SparseSet : un ComponentStorage par type, ajout/suppression pas cher (composants souvent ajoutes/enleves)
+// Archetype : les entites qui ont le meme ensemble de composants Archetype sont rangees ensemble dans des chunks SoA
+// Stable : sparse set dont les composants ne bougent jamais (pages), remove laisse un trou au lieu de deplacer le dernier
+//          pour les gros composants : suppression sans copie, pointeurs valides d'une frame a l'autre jusqu'a Registry::compact()
+enum class StorageMode { SparseSet, Archetype, Stable };
+
+//par defaut tout est en sparse set, on specialise pour changer de mode :
+//template<> struct StoragePolicy<Velocity> { static constexpr StorageMode mode = StorageMode::Archetype; };
+template<typename Component>
+struct StoragePolicy {
+    static constexpr StorageMode mode = StorageMode::SparseSet;
+};
+
+template<typename Component>
+constexpr bool isArchetypeComponent = StoragePolicy<Component>::mode == StorageMode::Archetype;
+
+const size_t STABLE_PAGE_SIZE = 1024; //nombre de composants par page d'un storage Stable
+
+class IGroup;
+
+//callback appele par un storage quand une entity recoit (construct) ou va perdre (destroy) le composant
+struct StorageListener {
+    const void * owner; //permet de retirer tous les callbacks d'un meme objet
+    function<void(Entity)> callback;
+};
+
+//traduit un handle d'un registry vers un autre (Registry::merge), INVALID si l'entity n'existe plus
+using EntityRemap = function<Entity(Entity)>;
+
+//un composant qui garde des handles d'autres entites declare remapEntities(const EntityRemap &) pour les traduire lors d'un merge
+template<typename Component, typename = void>
+struct HasRemapEntities : false_type {};
+
+template<typename Component>
+struct HasRemapEntities<Component, void_t<decltype(declval<Component &>().remapEntities(declval<const EntityRemap &>()))>> : true_type {};
+
+class Registry;
+
+//onAttach / onDetach sont facultatifs : un composant ne les declare que s'il a quelque chose a faire
+template<typename Component, typename = void>
+struct HasOnAttach : false_type {};
+
+template<typename Component>
+struct HasOnAttach<Component, void_t<decltype(declval<Component &>().onAttach(declval<Registry &>(), declval<Entity>()))>> : true_type {};
+
+template<typename Component, typename = void>
+struct HasOnDetach : false_type {};
+
+template<typename Component>
+struct HasOnDetach<Component, void_t<decltype(declval<Component &>().onDetach(declval<Registry &>(), declval<Entity>()))>> : true_type {};
+
+//entites desactivees (Registry::disable) : un bit par index d'entity, 1 = desactivee
+//le bitset ne grandit qu'a la premiere desactivation d'un index, au dela de sa taille tout est active
+inline bool isDisabled(const vector<uint64_t> & mask, Entity entity) {
+    uint32_t word = entityIndex(entity) >> 6;
+    return word < mask.size() && ((mask[word] >> (entityIndex(entity) & 63)) & 1);
+}
+
+//range des elements selon order (order[i] = position actuelle de l'element qui doit finir en i) avec swap(a, b)
+//chaque cycle de la permutation est suivi une seule fois : au plus n echanges
+template<typename Swap>
+void applyPermutation(vector<uint32_t> & order, Swap && swap) {
+    for (uint32_t i = 0; i < order.size(); i++) {
+        uint32_t current = i;
+        while (order[current] != i) {
+            uint32_t next = order[current];
+            swap(current, next);
+            order[current] = current;
+            current = next;
+        }
+        order[current] = current;
+    }
+}
+
 class IComponentStorage {
 public:
     virtual ~IComponentStorage() = default;
     virtual const bool has(Entity entity) = 0;
     virtual void remove(Entity entity) = 0;
+    virtual bool changedSince(Entity entity, uint32_t version) const = 0;
+    virtual bool addedSince(Entity entity, uint32_t version) const = 0;
+
+    virtual unique_ptr<IComponentStorage> makeEmpty() const = 0; //storage vide du meme type
+    virtual void moveInto(IComponentStorage & target, const EntityRemap & remap, uint32_t version) = 0; //target doit etre du meme type
+    virtual void stampAll(uint32_t version) = 0; //tous les composants deviennent ajoutes a version
+    virtual void disconnect(const void * listenerOwner) = 0; //retire les callbacks de listenerOwner
+    virtual void compact() = 0; //rebouche les trous d'un storage Stable, ne fait rien sinon
+};
+
+//tableau de composants d'un storage Stable, alloue par pages : un element ne change jamais d'adresse
+//une case videe par reset reste un trou jusqu'a ce qu'on la reutilise ou qu'on tasse le tableau (relocate / truncate)
+template<typename Component>
+class StableArray {
+    vector<unique_ptr<optional<Component>[]>> pages;
+    size_t count = 0; //cases utilisees, trous compris
+
+    inline optional<Component> & slot(size_t i) const { return pages[i / STABLE_PAGE_SIZE][i % STABLE_PAGE_SIZE]; }
+
+public:
+    inline size_t size() const { return count; }
+
+    inline Component & operator[](size_t i) { return *slot(i); }
+
+    void reserve(size_t capacity){
+        while (pages.size() * STABLE_PAGE_SIZE < capacity) pages.push_back(make_unique<optional<Component>[]>(STABLE_PAGE_SIZE));
+    }
+
+    void push_back(Component && component){
+        reserve(count + 1);
+        slot(count++).emplace(std::move(component));
+    }
+
+    inline void emplace(size_t i, Component && component){ slot(i).emplace(std::move(component)); }
+
+    inline void reset(size_t i){ slot(i).reset(); }
+
+    //deplace l'element from dans la case vide to
+    void relocate(size_t to, size_t from){
+        slot(to).emplace(std::move(*slot(from)));
+        slot(from).reset();
+    }
+
+    void truncate(size_t newCount){
+        for (size_t i = newCount; i < count; i++) slot(i).reset();
+        count = newCount;
+    }
 };
 
 template<typename Component> //rend la classe générique et utilisable avec n'importe quelle struct Component
 class ComponentStorage : public IComponentStorage{ //stocke les composants pour un unique type de composant 
+    public:
+    //tag (struct vide, ex: struct Static {};) : seule la presence compte, le storage n'a que le sparse set et pas de tableau de composants
+    static constexpr bool isTag = is_empty_v<Component>;
+    //StorageMode::Stable (un tag n'a pas de composants a garder en place, il reste un sparse set normal)
+    static constexpr bool isStable = StoragePolicy<Component>::mode == StorageMode::Stable && !isTag;
+
     private:
     //utilise un sparse set https://www.geeksforgeeks.org/sparse-set/
-    vector<uint32_t> sparse; // permet de lier les entity à leur composant en gardant les entites proches les unes des autres
-    vector<Component> components; //contient les composants 
-    vector<Entity> entities; //contient les entités qui ont ce composant  
+    //le sparse est decoupe en pages de SPARSE_PAGE_SIZE allouees seulement quand une entity de la page recoit le composant
+    //chaque entree contient makeEntity(index dans entities, generation de l'entity) ou INVALID
+    vector<unique_ptr<uint32_t[]>> sparse; // permet de lier les entity à leur composant en gardant les entites proches les unes des autres
+    conditional_t<isStable, StableArray<Component>, vector<Component>> components; //contient les composants (reste vide pour un tag)
+    inline static Component tag{}; //renvoye par get pour un tag, toutes les entites le partagent
+    vector<Entity> entities; //contient les entités qui ont ce composant (INVALID pour un trou d'un storage Stable)
+    vector<uint32_t> freeSlots; //Stable : trous laisses par remove, reutilises par add
+
+    //versions d'ecriture, rangees comme components : version du registry lors de l'ajout / de la derniere modif
+    vector<uint32_t> addedVersions;
+    vector<uint32_t> changedVersions;
+    atomic<uint32_t> lastChange{0}; //plus grande version ecrite, permet de sauter tout le storage
+    uint32_t layout = 0; //incremente quand des composants peuvent changer d'adresse ou de place (voir layoutVersion)
+
+    inline uint32_t * findSlot(Entity entity) const {
+        uint32_t page = entityIndex(entity) / SPARSE_PAGE_SIZE;
+        if(page >= sparse.size() || !sparse[page]) return nullptr;
+        return &sparse[page][entityIndex(entity) % SPARSE_PAGE_SIZE];
+    }
+
+    uint32_t & assureSlot(Entity entity){ //alloue la page si besoin
+        uint32_t page = entityIndex(entity) / SPARSE_PAGE_SIZE;
+        if(page >= sparse.size()){
+            sparse.resize(page + 1);
+        }
+        if(!sparse[page]){
+            sparse[page].reset(new uint32_t[SPARSE_PAGE_SIZE]);
+            std::fill(sparse[page].get(), sparse[page].get() + SPARSE_PAGE_SIZE, INVALID);
+        }
+        return sparse[page][entityIndex(entity) % SPARSE_PAGE_SIZE];
+    }
 
     public:
 
-    ComponentStorage(){
-        sparse.resize(MAX_ENTITIES, INVALID);
-        entities.reserve(MAX_ENTITIES); //reserve la memoire mais n'initialise rien (apres reserve la entities.size() = 0 toujours)
-        components.reserve(MAX_ENTITIES);
+    vector<StorageListener> constructListeners; //appeles apres l'ajout d'un nouveau composant
+    vector<StorageListener> destroyListeners; //appeles avant la suppression d'un composant
+    vector<StorageListener> updateListeners; //appeles par markChanged (peut venir de plusieurs threads)
+    IGroup * owner = nullptr; //groupe qui possede ce storage (il impose l'ordre des elements)
+
+#ifndef NDEBUG
+    //acces en cours depuis des par_each, pour detecter les data races en debug
+    atomic<int> parallelReaders{0};
+    atomic<int> parallelWriters{0};
+#endif
+
+    ComponentStorage() = default;
+
+    //debut / fin d'un parcours parallele : plusieurs lecteurs ou un seul ecrivain a la fois
+    inline void beginParallelAccess(bool readOnly){
+#ifndef NDEBUG
+        if (readOnly) {
+            parallelReaders++;
+            assert(parallelWriters == 0 && "composant lu pendant qu'un autre par_each l'ecrit");
+        } else {
+            assert(parallelWriters++ == 0 && parallelReaders == 0 && "composant ecrit par deux parcours paralleles");
+        }
+#endif
+    }
+
+    inline void endParallelAccess(bool readOnly){
+#ifndef NDEBUG
+        if (readOnly) parallelReaders--;
+        else parallelWriters--;
+#endif
+    }
+
+    //un ajout / une suppression pendant un par_each deplace des elements lus par les autres threads
+    inline void assertNoParallelAccess() const {
+#ifndef NDEBUG
+        assert(parallelReaders == 0 && parallelWriters == 0 && "changement structurel pendant un par_each");
+#endif
+    }
+
+    inline const bool has(Entity entity){
+        const uint32_t * slot = findSlot(entity);
+        return slot && *slot != INVALID && entityGeneration(*slot) == entityGeneration(entity); //un handle perime n'a pas la meme generation
+    }
+
+    inline Component & get(Entity entity) {
+        if constexpr (isTag) return tag;
+        else return components[entityIndex(*findSlot(entity))];
     }
 
-    inline const bool has(Entity entity){return sparse[entity] != INVALID;}
+    inline const std::vector<Entity> & getEntities() {return entities;} //peut contenir des INVALID (trous d'un storage Stable)
+
+    inline Component * data() {return components.data();}
+
+    inline uint32_t index(Entity entity) const {return entityIndex(*findSlot(entity));} //position dans entities / components
+
+    inline size_t size() const {return entities.size();} //trous compris pour un storage Stable
+
+    inline size_t holes() const {return freeSlots.size();}
+
+    //change a chaque ajout / suppression / reallocation / echange : un pointeur ou un index garde sur un composant
+    //reste valable tant que layoutVersion n'a pas bouge
+    inline uint32_t layoutVersion() const {return layout;}
 
-    inline Component & get(Entity entity) {return components[sparse[entity]];}
+    void reserve(size_t capacity){
+        layout++;
+        entities.reserve(capacity); //reserve la memoire mais n'initialise rien (apres reserve la entities.size() = 0 toujours)
+        if constexpr (!isTag) components.reserve(capacity);
+        addedVersions.reserve(capacity);
+        changedVersions.reserve(capacity);
+    }
 
-    inline const std::vector<Entity> & getEntities() {return entities;}
+    //prevoit count ajouts en une seule reallocation, en gardant une croissance geometrique
+    void reserveMore(size_t count){
+        size_t needed = entities.size() + count;
+        if (needed > entities.capacity()) reserve(std::max(needed, entities.capacity() * 2));
+    }
 
-    void add(Entity entity, Component component){
+    //un ajout compte aussi comme une modification
+    void add(Entity entity, Component component, uint32_t version = 0){
+        assertNoParallelAccess();
 
         if(!has(entity)){ //si l'entity n'as pas deja ce composant
-            sparse[entity] = entities.size();
-            entities.push_back(entity); 
-            components.push_back( move(component) ); //move permet de bouger completement le composant dans l'array pour ne pas qu'il soit supprimer si il sort du scope 
+            layout++;
+            uint32_t position = entities.size();
+            if constexpr (isStable) {
+                if (!freeSlots.empty()) { //on rebouche un trou
+                    position = freeSlots.back();
+                    freeSlots.pop_back();
+                }
+            }
+            assureSlot(entity) = makeEntity(position, entityGeneration(entity));
+
+            if (position == entities.size()) {
+                entities.push_back(entity); 
+                if constexpr (!isTag) components.push_back( move(component) ); //move permet de bouger completement le composant dans l'array pour ne pas qu'il soit supprimer si il sort du scope 
+                addedVersions.push_back(version);
+                changedVersions.push_back(version);
+            } else {
+                entities[position] = entity;
+                if constexpr (isStable) components.emplace(position, move(component));
+                addedVersions[position] = version;
+                changedVersions[position] = version;
+            }
+            raiseLastChange(version);
+
+            for (StorageListener & listener : constructListeners) listener.callback(entity);
 
         }else{
-            components[sparse[entity]] = std::move(component);
+            if constexpr (!isTag) get(entity) = std::move(component);
+            markChanged(entity, version);
+        }
+
+    }
+
+    //peut etre appele depuis un par_each : chaque entity n'est ecrite que par un thread
+    inline void markChanged(Entity entity, uint32_t version){
+        changedVersions[index(entity)] = version;
+        raiseLastChange(version);
+        for (StorageListener & listener : updateListeners) listener.callback(entity);
+    }
+
+    //lastChange ne recule jamais : une ecriture avec une version plus ancienne (depuis un autre thread, ou stampAll
+    //apres un merge) ne doit pas cacher une modification plus recente a changedSince
+    inline void raiseLastChange(uint32_t version){
+        uint32_t current = lastChange.load(memory_order_relaxed);
+        while (current < version && !lastChange.compare_exchange_weak(current, version, memory_order_relaxed)) {}
+    }
+
+    //vrai si un composant du storage a ete ajoute / modifie apres version
+    inline bool changedSince(uint32_t version) const { return lastChange.load(memory_order_relaxed) > version; }
+
+    bool changedSince(Entity entity, uint32_t version) const override { return changedVersions[index(entity)] > version; }
+
+    bool addedSince(Entity entity, uint32_t version) const override { return addedVersions[index(entity)] > version; }
+
+    unique_ptr<IComponentStorage> makeEmpty() const override { return make_unique<ComponentStorage<Component>>(); }
+
+    //deplace tous les composants vers target sous leur nouveau handle, sans rappeler onAttach (ils sont deja attaches)
+    void moveInto(IComponentStorage & target, const EntityRemap & remap, uint32_t version) override {
+        ComponentStorage<Component> & destination = static_cast<ComponentStorage<Component> &>(target);
+        destination.reserveMore(entities.size());
+        for (size_t i = 0; i < entities.size(); i++) {
+            if (entities[i] == INVALID) continue; //trou d'un storage Stable
+            if constexpr (isTag) {
+                destination.add(remap(entities[i]), Component{}, version);
+            } else {
+                if constexpr (HasRemapEntities<Component>::value) components[i].remapEntities(remap);
+                destination.add(remap(entities[i]), std::move(components[i]), version);
+            }
         }
+    }
 
+    void stampAll(uint32_t version) override {
+        std::fill(addedVersions.begin(), addedVersions.end(), version);
+        std::fill(changedVersions.begin(), changedVersions.end(), version);
+        raiseLastChange(version);
     }
 
     void remove(Entity entity){
         assert(has(entity));
+        assertNoParallelAccess();
 
-        uint32_t index = sparse[entity];
+        for (StorageListener & listener : destroyListeners) listener.callback(entity); //peut deplacer l'entity (groupes)
+
+        uint32_t & slot = *findSlot(entity);
+        uint32_t index = entityIndex(slot);
+        layout++;
+
+        if constexpr (isStable) {
+            //suppression sur place : le composant est detruit, la case devient un trou et rien d'autre ne bouge
+            components.reset(index);
+            entities[index] = INVALID;
+            freeSlots.push_back(index);
+            slot = INVALID;
+            return;
+        }
 
         Entity lastEntity = entities.back(); //on recup le dernier element pour le mettre a la place de celui qu'on supprime
-        Component lastComponent = components.back();
 
         //on le remplace
         entities[index] = lastEntity; 
-        components[index] = std::move(lastComponent);
+        if constexpr (!isTag && !isStable) {
+            components[index] = std::move(components.back()); //deplace sans copie (le dernier est retire juste apres)
+            components.pop_back();
+        }
+        addedVersions[index] = addedVersions.back();
+        changedVersions[index] = changedVersions.back();
 
-        sparse[lastEntity] = index; //met a jour le lien
+        *findSlot(lastEntity) = makeEntity(index, entityGeneration(lastEntity)); //met a jour le lien
         
         entities.pop_back();
-        components.pop_back();
+        addedVersions.pop_back();
+        changedVersions.pop_back();
         
-        sparse[entity] = INVALID;
+        slot = INVALID;
+    }
+
+    //trie les composants sur place (entites, composants, versions et sparse suivent)
+    //compare(const Component &, const Component &) ou compare(Entity, Entity), l'ordre des egaux est garde
+    //comme compact : un storage Stable est d'abord tasse et ses composants changent d'adresse
+    template<typename Compare>
+    void sort(Compare compare){
+        assert(owner == nullptr && "storage possede par un groupe : trier le groupe");
+        compact();
+
+        vector<uint32_t> order(entities.size());
+        iota(order.begin(), order.end(), 0);
+        stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b){
+            if constexpr (!isTag && is_invocable_v<Compare, const Component &, const Component &>) return compare(as_const(components[a]), as_const(components[b]));
+            else return compare(entities[a], entities[b]);
+        });
+        applyPermutation(order, [this](uint32_t a, uint32_t b){ swapEntries(a, b); });
+    }
+
+    //met les entites de ce storage dans l'ordre de reference (les entites d'un autre storage),
+    //celles qui n'y sont pas se retrouvent a la fin
+    void sortAs(const vector<Entity> & reference){
+        assert(owner == nullptr && "storage possede par un groupe : trier le groupe");
+        compact();
+
+        uint32_t position = 0;
+        for (Entity entity : reference) {
+            if (entity != INVALID && has(entity)) swapEntries(index(entity), position++);
+        }
+    }
+
+    //echange deux elements en gardant le sparse a jour
+    void swapEntries(uint32_t a, uint32_t b){
+        if (a == b) return;
+        assertNoParallelAccess();
+        layout++;
+        std::swap(entities[a], entities[b]);
+        if constexpr (!isTag) std::swap(components[a], components[b]);
+        std::swap(addedVersions[a], addedVersions[b]);
+        std::swap(changedVersions[a], changedVersions[b]);
+        *findSlot(entities[a]) = makeEntity(a, entityGeneration(entities[a]));
+        *findSlot(entities[b]) = makeEntity(b, entityGeneration(entities[b]));
+    }
+
+    //Stable : tasse les composants en gardant leur ordre, ceux qui bougent changent d'adresse
+    void compact() override {
+        if constexpr (isStable) {
+            if (freeSlots.empty()) return;
+            assertNoParallelAccess();
+            layout++;
+
+            uint32_t write = 0;
+            for (uint32_t read = 0; read < entities.size(); read++) {
+                if (entities[read] == INVALID) continue;
+                if (read != write) {
+                    entities[write] = entities[read];
+                    components.relocate(write, read);
+                    addedVersions[write] = addedVersions[read];
+                    changedVersions[write] = changedVersions[read];
+                    *findSlot(entities[write]) = makeEntity(write, entityGeneration(entities[write]));
+                }
+                write++;
+            }
+
+            entities.resize(write);
+            components.truncate(write);
+            addedVersions.resize(write);
+            changedVersions.resize(write);
+            freeSlots.clear();
+        }
+    }
+
+    void disconnect(const void * listenerOwner) override {
+        auto fromOwner = [listenerOwner](const StorageListener & listener){ return listener.owner == listenerOwner; };
+        constructListeners.erase(remove_if(constructListeners.begin(), constructListeners.end(), fromOwner), constructListeners.end());
+        destroyListeners.erase(remove_if(destroyListeners.begin(), destroyListeners.end(), fromOwner), destroyListeners.end());
+        updateListeners.erase(remove_if(updateListeners.begin(), updateListeners.end(), fromOwner), updateListeners.end());
     }
 
 };
 
-template<typename... Components> //les ... indique qu'on peut passer plusieur composants View<Position, Velocity> 
-class View{ //peut etre ameliorer
+enum class ObserverEvent { Construct, Update, Destroy };
 
-    tuple<ComponentStorage<Components>*...> storages;  //un tuple de storage 
+//file des entites touchees par un evenement sur un composant (registry.observe<T>(event)),
+//remplie par le storage et videe en un seul lot par le systeme qui la traite
+//une entity n'y est qu'une fois, et pour Construct / Update elle en sort si elle perd le composant avant le traitement
+class Observer {
+    IComponentStorage * storage;
+    vector<Entity> entities; //ordre d'arrivee, peut contenir des entites deja sorties
+    vector<Entity> queued; //indexe par entityIndex : handle en attente ou INVALID
+    size_t count = 0;
+    mutex lock; //markChanged peut etre appele depuis plusieurs threads
+    atomic<bool> paused{false};
+
+public:
+    explicit Observer(IComponentStorage * storage) : storage(storage) {}
+    ~Observer() { storage->disconnect(this); }
+
+    Observer(const Observer &) = delete;
+    Observer & operator=(const Observer &) = delete;
+
+    void push(Entity entity){
+        if (paused.load(memory_order_relaxed)) return;
+        lock_guard<mutex> guard(lock);
+        uint32_t index = entityIndex(entity);
+        if (index >= queued.size()) queued.resize(index + 1, INVALID);
+        if (queued[index] == entity) return;
+        if (queued[index] == INVALID) count++;
+        queued[index] = entity;
+        entities.push_back(entity);
+    }
+
+    void drop(Entity entity){
+        lock_guard<mutex> guard(lock);
+        uint32_t index = entityIndex(entity);
+        if (index < queued.size() && queued[index] == entity) {
+            queued[index] = INVALID;
+            count--;
+        }
+    }
+
+    //le systeme qui vide la file peut ignorer les evenements de son propre passage (ses ecritures ne sont pas des entrees)
+    inline void setPaused(bool value){ paused.store(value, memory_order_relaxed); }
+
+    inline size_t size() const { return count; }
+    inline bool empty() const { return count == 0; }
+
+    //renvoie les entites en attente et vide la file
+    vector<Entity> take(){
+        lock_guard<mutex> guard(lock);
+        vector<Entity> ready;
+        ready.reserve(count);
+        for (Entity entity : entities) {
+            uint32_t index = entityIndex(entity);
+            if (queued[index] != entity) continue;
+            queued[index] = INVALID;
+            ready.push_back(entity);
+        }
+        entities.clear();
+        count = 0;
+        return ready;
+    }
+
+    //vide la file sans renvoyer les entites (quand seul "il s'est passe quelque chose" compte)
+    void clear(){
+        lock_guard<mutex> guard(lock);
+        for (Entity entity : entities) queued[entityIndex(entity)] = INVALID;
+        entities.clear();
+        count = 0;
+    }
+
+    //func(entity) pour chaque entity en attente, func peut ajouter / enlever des composants
+    template<typename function>
+    void each(function&& func){
+        for (Entity entity : take()) func(entity);
+    }
+};
+
+//storage d'un composant demande a une view, const T veut dire que la view ne fait que lire T
+template<typename Component>
+using StorageFor = ComponentStorage<remove_const_t<Component>>;
+
+//liste des composants qu'une view doit exclure : registry.view<Transform>(exclude<Hierarchy>)
+template<typename... Excluded>
+struct Exclude {};
+
+template<typename... Excluded>
+inline constexpr Exclude<Excluded...> exclude{};
+
+template<typename ExcludeList, typename... Components>
+class BasicView;
+
+template<typename... Excluded, typename... Components> //les ... indique qu'on peut passer plusieur composants View<Position, Velocity> 
+class BasicView<Exclude<Excluded...>, Components...>{
+
+    tuple<StorageFor<Components>*...> storages;  //un tuple de storage 
+    tuple<ComponentStorage<Excluded>*...> excludedStorages; //les entites presentes dans un de ces storages sont ignorees
+    const vector<Entity> * driver; //entites du plus petit storage, c'est lui qu'on parcourt
+    const vector<uint64_t> * disabled = nullptr; //bitset du registry, nullptr pour voir aussi les entites desactivees
+
+    //filtres changed<T>(version) / added<T>(version)
+    struct VersionFilter {
+        const IComponentStorage * storage;
+        uint32_t version;
+        bool added;
+    };
+    vector<VersionFilter> filters;
+
+    inline bool passesFilters(Entity e) const {
+        for (const VersionFilter & filter : filters) {
+            if (filter.added ? !filter.storage->addedSince(e, filter.version) : !filter.storage->changedSince(e, filter.version)) return false;
+        }
+        return true;
+    }
+
+    template<typename Component>
+    BasicView withFilter(uint32_t version, bool added) const {
+        static_assert((is_same_v<StorageFor<Component>, StorageFor<Components>> || ...), "le composant filtre doit faire partie de la view");
+        static const vector<Entity> none;
+
+        BasicView filtered = *this;
+        StorageFor<Component> * storage = std::get<StorageFor<Component>*>(storages);
+        filtered.filters.push_back({storage, version, added});
+        if (!storage->changedSince(version)) filtered.driver = &none; //rien n'a bouge dans ce storage, on ne parcourt rien
+        return filtered;
+    }
 
 public: 
-    View( tuple<ComponentStorage<Components>*...>  storages_in){
+    BasicView( tuple<StorageFor<Components>*...>  storages_in, tuple<ComponentStorage<Excluded>*...> excluded_in = {}, const vector<uint64_t> * disabled_in = nullptr){
         storages = storages_in;
+        excludedStorages = excluded_in;
+        disabled = disabled_in;
+
+        driver = &std::get<0>(storages)->getEntities();
+        ((driver = std::get<StorageFor<Components>*>(storages)->size() < driver->size() ? &std::get<StorageFor<Components>*>(storages)->getEntities() : driver), ...);
     }
 
     template<typename Component>
     Component & get(Entity e) const {
-        ComponentStorage<Component> * storage = std::get<ComponentStorage<Component>*>(storages);
+        static_assert(is_const_v<Component> || !(is_same_v<const Component, Components> || ...), "composant declare en lecture seule dans la view");
+        StorageFor<Component> * storage = std::get<StorageFor<Component>*>(storages);
         assert(storage->has(e));
         return storage->get(e);
     }
 
+    //vrai si l entity est active, a tous les composants et aucun des composants exclus
+    inline bool contains(Entity e) const {
+        return (!disabled || !isDisabled(*disabled, e))
+            && (std::get<StorageFor<Components>*>(storages)->has(e) && ...)
+            && !(std::get<ComponentStorage<Excluded>*>(excludedStorages)->has(e) || ...)
+            && (filters.empty() || passesFilters(e));
+    }
+
+    //ne garde que les entites dont le composant a ete ajoute ou modifie apres version
+    template<typename Component>
+    BasicView changed(uint32_t version) const { return withFilter<Component>(version, false); }
+
+    //ne garde que les entites qui ont recu le composant apres version
+    template<typename Component>
+    BasicView added(uint32_t version) const { return withFilter<Component>(version, true); }
+
+    //la meme view sans sauter les entites desactivees (ex: le systeme qui les reactive)
+    BasicView withDisabled() const {
+        BasicView all = *this;
+        all.disabled = nullptr;
+        return all;
+    }
+
+    //nombre d'entites parcourues au maximum (taille du plus petit storage)
+    inline size_t sizeHint() const { return driver->size(); }
+
     template<typename function> 
     void each(function&& func){ // le && permet de garder le type de passage des arguments(reference ou copie) un peu comme std::forward
 
-        auto storageSmallest = std::get<0>(storages); //trouver un moyen simple de choisir le plus petit des storages
+        for (Entity e : *driver) {
+            if (contains(e)) {
 
-        for (Entity e : storageSmallest->getEntities()) {
-            if ((std::get<ComponentStorage<Components>*>(storages)->has(e) && ...)) { //si l entity a tous les composants
-
-                func(e, std::get<ComponentStorage<Components>*>(storages)->get(e)...);
+                func(e, static_cast<Components &>(std::get<StorageFor<Components>*>(storages)->get(e))...);
 
             }
         }
     }
 
+    //comme each mais reparti sur le ThreadPool par morceaux de grainSize entites
+    //func ne doit pas ajouter / enlever de composants, les composants const ne sont que lus (verifie en debug)
+    template<typename function>
+    void par_each(function&& func, size_t grainSize = 256){
+        (std::get<StorageFor<Components>*>(storages)->beginParallelAccess(is_const_v<Components>), ...);
+
+        const vector<Entity> & entities = *driver;
+        ThreadPool::getInstance().parallelFor(entities.size(), grainSize, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                Entity e = entities[i];
+                if (contains(e)) {
+                    func(e, static_cast<Components &>(std::get<StorageFor<Components>*>(storages)->get(e))...);
+                }
+            }
+        });
+
+        (std::get<StorageFor<Components>*>(storages)->endParallelAccess(is_const_v<Components>), ...);
+    }
+
     //bien aidé par chatGPT ici c etait galere
     class Iterator {
         public:
             using Iter = typename vector<Entity>::const_iterator;
         
-            Iterator(Iter current, Iter end, const tuple<ComponentStorage<Components>*...>& storages): current(current), end(end), storages(storages) {
+            Iterator(Iter current, Iter end, const BasicView * view): current(current), end(end), view(view) {
                 skip_invalid();
             }
         
@@ -128,27 +720,28 @@ public:
         
         private:
             Iter current, end;
-            const tuple<ComponentStorage<Components>*...> & storages;
+            const BasicView * view;
         
             void skip_invalid() {
-                while (current != end && !( std::get<ComponentStorage<Components>*>(storages)->has(*current) && ...)) {
+                while (current != end && !view->contains(*current)) {
                     ++current;
                 }
             }
     };
 
     Iterator begin() const {
-        const auto& entities = std::get<0>(storages)->getEntities();
-        return Iterator(entities.begin(), entities.end(), storages);
+        return Iterator(driver->begin(), driver->end(), this);
     }
 
     Iterator end() const {
-        const auto& entities = std::get<0>(storages)->getEntities();
-        return Iterator(entities.end(), entities.end(), storages);
+        return Iterator(driver->end(), driver->end(), this);
     }
 
 };
 
+template<typename... Components>
+using View = BasicView<Exclude<>, Components...>;
+
 /* exemple :
     auto view = registry.view<Position, Velocity>();
 
@@ -157,110 +750,1271 @@ public:
         std::cout << "Entity " << e << " has pos (" << pos.x << ", " << pos.y << ")\n";
 
     }); 
+
+    //en parallele, Position n'est que lu
+    registry.view<const Position, Velocity>().par_each([](Entity e, const Position & pos, Velocity & vel) { ... });
+
+    //toutes les positions des entites qui n'ont pas de velocite
+    for (Entity e : registry.view<Position>(exclude<Velocity>)) { ... }
+
+    //tag : struct Sleeping {}; ne coute que le sparse set
+    registry.view<Position>(exclude<Sleeping>).each(...);
+
+    //seulement ce qui a change depuis le dernier passage du systeme
+    registry.view<Position, const Velocity>().changed<Velocity>(lastVersion).each(...);
+    lastVersion = registry.advanceVersion();
 */
 
 
-class Registry{
+//composants d'un groupe qui ne sont pas possedes : registry.group<CameraComponent>(with<Transform>)
+template<typename... Get>
+struct With {};
 
-private:
-    Entity nextEntityID = 0;
-    vector<Entity> FreeIDs; //les id des entites qu'on a detruit pour pouvoir les reutiliser
+template<typename... Get>
+inline constexpr With<Get...> with{};
+
+class IGroup {
+public:
+    virtual ~IGroup() = default;
+    virtual void setDisabledMask(const vector<uint64_t> * mask) = 0; //le groupe a change de registry (Registry::swap)
+};
 
-    vector<IComponentStorage *> componentStorages; //permet de savoir quelle composant sont utilisé    
+template<typename OwnedList, typename GetList>
+class BasicGroup;
 
-    template<typename Component>
-    ComponentStorage<Component> & getComponentStorage(){
-        static ComponentStorage<Component> storage; //le static assure que ce n'est initialise qu'une fois et que donc on reutilise le meme storage chaque fois
+//groupe possedant (facon EnTT) : les storages possedes sont reordonnes pour que les entites qui ont tous les composants
+//du groupe soient dans les `length` premieres cases, au meme index dans chaque storage possede
+//on itere alors directement sur les tableaux, sans passer par le sparse
+//un storage ne peut etre possede que par un seul groupe
+template<typename... Owned, typename... Get>
+class BasicGroup<tuple<Owned...>, With<Get...>> : public IGroup {
 
-        static bool isKnown = false; 
+    tuple<ComponentStorage<Owned>*...> owned;
+    tuple<ComponentStorage<Get>*...> gets;
+    size_t length = 0; //taille du prefixe groupe
+    const vector<uint64_t> * disabled; //bitset du registry : each / par_each sautent les entites desactivees
+
+    static_assert(!(ComponentStorage<Owned>::isTag || ...), "un tag n'a pas de tableau a posseder, le mettre dans with<>");
+    static_assert(!(ComponentStorage<Owned>::isStable || ...), "un groupe deplace les composants possedes, un composant Stable va dans with<>");
+
+    using First = ComponentStorage<typename tuple_element<0, tuple<Owned...>>::type>;
+
+    inline First * first() const { return std::get<0>(owned); }
+
+    inline bool matches(Entity e) const {
+        return (std::get<ComponentStorage<Owned>*>(owned)->has(e) && ...) && (std::get<ComponentStorage<Get>*>(gets)->has(e) && ...);
+    }
+
+    inline bool inGroup(Entity e) const { return first()->has(e) && first()->index(e) < length; }
+
+    //appele apres l'ajout d'un composant du groupe : si l'entity a maintenant tout, on la ramene a la fin du prefixe
+    void onConstruct(Entity e) {
+        if (!inGroup(e) && matches(e)) {
+            (std::get<ComponentStorage<Owned>*>(owned)->swapEntries(std::get<ComponentStorage<Owned>*>(owned)->index(e), length), ...);
+            ++length;
+        }
+    }
 
-        if(!isKnown){ //permet de savoir quelle type de composant on utilise
-            isKnown = true;
-            componentStorages.push_back(&storage);
+    //appele avant la suppression d'un composant du groupe : on sort l'entity du prefixe
+    void onDestroy(Entity e) {
+        if (inGroup(e)) {
+            --length;
+            (std::get<ComponentStorage<Owned>*>(owned)->swapEntries(std::get<ComponentStorage<Owned>*>(owned)->index(e), length), ...);
         }
+    }
 
-        return storage;
+    template<typename Storage>
+    void connect(Storage * storage) {
+        storage->constructListeners.push_back({this, [this](Entity e){ onConstruct(e); }});
+        storage->destroyListeners.push_back({this, [this](Entity e){ onDestroy(e); }});
     }
 
 public:
-    inline Entity create() {
-        if(FreeIDs.empty()){
-            return nextEntityID++;
-        }else{
-            Entity newID = FreeIDs.back(); //on recup l'ID du dernier element detruit
-            FreeIDs.pop_back();
-            return newID;
+    BasicGroup(tuple<ComponentStorage<Owned>*...> owned_in, tuple<ComponentStorage<Get>*...> gets_in, const vector<uint64_t> * disabled_in) : owned(owned_in), gets(gets_in), disabled(disabled_in) {
+        ((assert(std::get<ComponentStorage<Owned>*>(owned)->owner == nullptr), std::get<ComponentStorage<Owned>*>(owned)->owner = this), ...);
+        (connect(std::get<ComponentStorage<Owned>*>(owned)), ...);
+        (connect(std::get<ComponentStorage<Get>*>(gets)), ...);
+
+        //on range les entites deja presentes
+        for (size_t i = 0; i < first()->size(); i++) {
+            onConstruct(first()->getEntities()[i]);
         }
     }
 
-    //on itere a travers tous les types de composant pour essayer de supprimer l entity
-    void destroy(Entity entity){
+    ~BasicGroup() {
+        ((std::get<ComponentStorage<Owned>*>(owned)->owner = nullptr, std::get<ComponentStorage<Owned>*>(owned)->disconnect(this)), ...);
+        (std::get<ComponentStorage<Get>*>(gets)->disconnect(this), ...);
+    }
 
-        for (IComponentStorage* storage : componentStorages) {
-            if (storage->has(entity)) {
-                storage->remove(entity);
-            }
-        }
+    BasicGroup(const BasicGroup &) = delete;
+    BasicGroup & operator=(const BasicGroup &) = delete;
 
-        FreeIDs.push_back(entity);
+    void setDisabledMask(const vector<uint64_t> * mask) override { disabled = mask; }
 
+    inline size_t size() const { return length; }
+
+    //trie les entites du groupe avec compare(Entity, Entity), tous les composants possedes suivent
+    template<typename Compare>
+    void sort(Compare compare) {
+        const vector<Entity> & entities = first()->getEntities();
+        vector<uint32_t> order(length);
+        iota(order.begin(), order.end(), 0);
+        stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b){ return compare(entities[a], entities[b]); });
+        applyPermutation(order, [this](uint32_t a, uint32_t b){
+            (std::get<ComponentStorage<Owned>*>(owned)->swapEntries(a, b), ...);
+        });
     }
 
     template<typename Component>
-    inline bool has(Entity entity){
-        return getComponentStorage<Component>().has(entity);
+    Component & get(Entity e) const {
+        if constexpr ((is_same_v<Component, Get> || ...)) return std::get<ComponentStorage<Component>*>(gets)->get(e);
+        else return std::get<ComponentStorage<Component>*>(owned)->get(e);
     }
 
-    template<typename Component>
-    inline Component & get(Entity entity){
-        return getComponentStorage<Component>().get(entity);
+    template<typename function>
+    void each(function&& func) {
+        const Entity * entities = first()->getEntities().data();
+        tuple<Owned*...> arrays(std::get<ComponentStorage<Owned>*>(owned)->data()...);
+
+        for (size_t i = 0; i < length; i++) {
+            if (isDisabled(*disabled, entities[i])) continue;
+            func(entities[i], std::get<Owned*>(arrays)[i]..., std::get<ComponentStorage<Get>*>(gets)->get(entities[i])...);
+        }
     }
 
-    template<typename Component>
-    inline void remove(Entity entity){
+    template<typename function>
+    void par_each(function&& func, size_t grainSize = 256) {
+        (std::get<ComponentStorage<Owned>*>(owned)->beginParallelAccess(false), ...);
+        (std::get<ComponentStorage<Get>*>(gets)->beginParallelAccess(false), ...);
 
-        auto& storage = getComponentStorage<Component>();
+        const Entity * entities = first()->getEntities().data();
+        tuple<Owned*...> arrays(std::get<ComponentStorage<Owned>*>(owned)->data()...);
 
-        Component& component = storage.get(entity);  
-        component.onDetach(*this, entity); 
+        ThreadPool::getInstance().parallelFor(length, grainSize, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                if (isDisabled(*disabled, entities[i])) continue;
+                func(entities[i], std::get<Owned*>(arrays)[i]..., std::get<ComponentStorage<Get>*>(gets)->get(entities[i])...);
+            }
+        });
 
-        storage.remove(entity);
+        (std::get<ComponentStorage<Owned>*>(owned)->endParallelAccess(false), ...);
+        (std::get<ComponentStorage<Get>*>(gets)->endParallelAccess(false), ...);
     }
 
-    template<typename Component, typename... Arguments>
-    Component & emplace(Entity entity, Arguments &&... arguments){ //ajoute un composant a une entite 
-        ComponentStorage<Component> & storage = getComponentStorage<Component>();
+    //l'iterateur parcourt tout le prefixe, entites desactivees comprises
+    using Iterator = typename vector<Entity>::const_iterator;
 
-        storage.add(entity , Component{ forward<Arguments>(arguments)... } ); //Component{ args } permet d'initialiser le composant
-                                                                           //forward permet de conserver les arguments (si ils sont passe par reference, on les passe par reference)
-                                                                            // si ils sont passés par copie on utilise les copies
-        Component & component = storage.get(entity);
+    Iterator begin() const { return first()->getEntities().begin(); }
+    Iterator end() const { return first()->getEntities().begin() + length; }
+};
 
-        component.onAttach(*this, entity);
+template<typename... Owned>
+using Group = BasicGroup<tuple<Owned...>, With<>>;
 
-        return component;
+/* exemple :
+    //Position et Velocity sont ranges ensemble, boucle sur des tableaux paralleles
+    registry.group<Position, Velocity>().each([](Entity e, Position & pos, Velocity & vel) { ... });
+
+    //Transform est possede, MeshComponent (Stable) est lu via le sparse
+    registry.group<Transform>(with<MeshComponent>).each([](Entity e, Transform & transform, MeshComponent & mesh) { ... });
+
+    //CameraComponent est possede, Transform est lu via le sparse (il est deja possede par le groupe au dessus)
+    registry.group<CameraComponent>(with<Transform>).each([](Entity e, CameraComponent & camera, Transform & transform) { ... });
+*/
+
+
+class IQuery {
+public:
+    virtual ~IQuery() = default;
+    virtual void setDisabledMask(const vector<uint64_t> * mask) = 0; //la requete a change de registry (Registry::swap)
+};
+
+template<typename ExcludeList, typename... Components>
+class BasicQuery;
+
+//requete persistante : creee une fois par registry.query<A, const B>(exclude<C>), la liste des entites qui correspondent
+//est tenue a jour a chaque ajout / suppression de composant, parcourir ne coute que le nombre de resultats
+//(une view parcourt tout son plus petit storage et teste chaque entity)
+//contrairement a un groupe rien n'est reordonne : n'importe quels storages, plusieurs requetes sur le meme composant
+template<typename... Excluded, typename... Components>
+class BasicQuery<Exclude<Excluded...>, Components...> : public IQuery {
+    static_assert(sizeof...(Components) > 0, "une requete a besoin d'au moins un composant");
+
+    tuple<StorageFor<Components>*...> storages;
+    tuple<ComponentStorage<Excluded>*...> excludedStorages;
+    const vector<uint64_t> * disabled; //bitset du registry : each / par_each sautent les entites desactivees
+
+    vector<Entity> matched; //entites qui correspondent, denses et dans un ordre quelconque
+    vector<uint32_t> positions; //indexe par entityIndex : position dans matched ou INVALID
+
+    //leaving : storage exclu que l'entity est en train de quitter (ses destroyListeners passent avant la suppression)
+    inline bool matches(Entity e, const IComponentStorage * leaving = nullptr) const {
+        return (std::get<StorageFor<Components>*>(storages)->has(e) && ...)
+            && !((std::get<ComponentStorage<Excluded>*>(excludedStorages) != leaving && std::get<ComponentStorage<Excluded>*>(excludedStorages)->has(e)) || ...);
     }
 
+    void insert(Entity e) {
+        uint32_t index = entityIndex(e);
+        if (index >= positions.size()) positions.resize(index + 1, INVALID);
+        if (positions[index] != INVALID) return;
+        positions[index] = matched.size();
+        matched.push_back(e);
+    }
 
-    template<typename... Components>
-    View<Components...> view() {
-        return View<Components...>( make_tuple( &getComponentStorage<Components>()...) );
+    void erase(Entity e) {
+        uint32_t index = entityIndex(e);
+        if (index >= positions.size() || positions[index] == INVALID) return;
+        uint32_t position = positions[index];
+        Entity last = matched.back();
+        matched[position] = last;
+        positions[entityIndex(last)] = position;
+        matched.pop_back();
+        positions[index] = INVALID;
     }
 
+    template<typename Storage>
+    void connectIncluded(Storage * storage) {
+        storage->constructListeners.push_back({this, [this](Entity e){ if (matches(e)) insert(e); }});
+        storage->destroyListeners.push_back({this, [this](Entity e){ erase(e); }});
+    }
 
-    void clear() {
-        for (IComponentStorage* storage : componentStorages) {
-            delete storage;
+    template<typename Storage>
+    void connectExcluded(Storage * storage) {
+        storage->constructListeners.push_back({this, [this](Entity e){ erase(e); }});
+        storage->destroyListeners.push_back({this, [this, storage](Entity e){ if (matches(e, storage)) insert(e); }});
+    }
+
+public:
+    BasicQuery(tuple<StorageFor<Components>*...> storages_in, tuple<ComponentStorage<Excluded>*...> excluded_in, const vector<uint64_t> * disabled_in)
+        : storages(storages_in), excludedStorages(excluded_in), disabled(disabled_in) {
+        (connectIncluded(std::get<StorageFor<Components>*>(storages)), ...);
+        (connectExcluded(std::get<ComponentStorage<Excluded>*>(excludedStorages)), ...);
+
+        //entites deja presentes, en partant du plus petit storage
+        const vector<Entity> * smallest = &std::get<0>(storages)->getEntities();
+        ((smallest = std::get<StorageFor<Components>*>(storages)->size() < smallest->size() ? &std::get<StorageFor<Components>*>(storages)->getEntities() : smallest), ...);
+        for (Entity e : *smallest) {
+            if (e != INVALID && matches(e)) insert(e);
         }
-        componentStorages.clear();
-        FreeIDs.clear();
-        nextEntityID = 0;
     }
 
+    ~BasicQuery() {
+        (std::get<StorageFor<Components>*>(storages)->disconnect(this), ...);
+        (std::get<ComponentStorage<Excluded>*>(excludedStorages)->disconnect(this), ...);
+    }
+
+    BasicQuery(const BasicQuery &) = delete;
+    BasicQuery & operator=(const BasicQuery &) = delete;
+
+    void setDisabledMask(const vector<uint64_t> * mask) override { disabled = mask; }
+
+    inline size_t size() const { return matched.size(); }
+    inline bool empty() const { return matched.empty(); }
+
+    //les resultats tels quels, entites desactivees comprises
+    inline const vector<Entity> & getEntities() const { return matched; }
+
+    inline bool contains(Entity e) const {
+        uint32_t index = entityIndex(e);
+        return index < positions.size() && positions[index] != INVALID && matched[positions[index]] == e && !isDisabled(*disabled, e);
+    }
+
+    template<typename Component>
+    Component & get(Entity e) const {
+        static_assert(is_const_v<Component> || !(is_same_v<const Component, Components> || ...), "composant declare en lecture seule dans la requete");
+        return std::get<StorageFor<Component>*>(storages)->get(e);
+    }
+
+    //func ne doit pas ajouter / enlever les composants de la requete (passer par un CommandBuffer)
+    template<typename function>
+    void each(function&& func) {
+        for (size_t i = 0; i < matched.size(); i++) {
+            Entity e = matched[i];
+            if (isDisabled(*disabled, e)) continue;
+            func(e, static_cast<Components &>(std::get<StorageFor<Components>*>(storages)->get(e))...);
+        }
+    }
+
+    template<typename function>
+    void par_each(function&& func, size_t grainSize = 256) {
+        (std::get<StorageFor<Components>*>(storages)->beginParallelAccess(is_const_v<Components>), ...);
+
+        ThreadPool::getInstance().parallelFor(matched.size(), grainSize, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                Entity e = matched[i];
+                if (isDisabled(*disabled, e)) continue;
+                func(e, static_cast<Components &>(std::get<StorageFor<Components>*>(storages)->get(e))...);
+            }
+        });
+
+        (std::get<StorageFor<Components>*>(storages)->endParallelAccess(is_const_v<Components>), ...);
+    }
+
+    //l'iterateur parcourt tous les resultats, entites desactivees comprises
+    using Iterator = typename vector<Entity>::const_iterator;
+
+    Iterator begin() const { return matched.begin(); }
+    Iterator end() const { return matched.end(); }
+};
+
+template<typename... Components>
+using Query = BasicQuery<Exclude<>, Components...>;
+
+/* exemple :
+    //rangee une fois (la requete vit dans le registry), puis reutilisee a chaque frame
+    auto & burning = registry.query<Health, const Fire>(exclude<Water>);
+
+    burning.each([](Entity e, Health & health, const Fire & fire) { health.value -= fire.damage; });
+*/
+
+
+const size_t ARCHETYPE_CHUNK_SIZE = 16 * 1024; //taille visee d'un chunk en octets
+
+//ce qu'il faut savoir d'un type pour le ranger dans une colonne sans connaitre le type
+struct ArchetypeColumnType {
+    uint32_t typeID;
+    size_t size;
+    size_t align;
+    void (*moveTo)(void * destination, void * source); //construit destination a partir de source puis detruit source
+    void (*destroy)(void * element);
+    void (*remapEntities)(void * element, const EntityRemap & remap); //nullptr si le composant ne garde pas de handles
+};
+
+template<typename Component>
+const ArchetypeColumnType & archetypeColumnType(){
+    static_assert(alignof(Component) <= alignof(max_align_t), "alignement non supporte dans un chunk");
+    static const ArchetypeColumnType type{
+        componentTypeID<Component>(), sizeof(Component), alignof(Component),
+        [](void * destination, void * source){
+            new (destination) Component(std::move(*static_cast<Component *>(source)));
+            static_cast<Component *>(source)->~Component();
+        },
+        [](void * element){ static_cast<Component *>(element)->~Component(); },
+        HasRemapEntities<Component>::value ? +[](void * element, const EntityRemap & remap){
+            if constexpr (HasRemapEntities<Component>::value) static_cast<Component *>(element)->remapEntities(remap);
+        } : nullptr
+    };
+    return type;
+}
 
+struct ArchetypeChunk {
+    unique_ptr<max_align_t[]> data; //les entites puis une colonne par composant
+    uint32_t count = 0;
 
+    inline Entity * entities() const { return reinterpret_cast<Entity *>(data.get()); }
 };
 
+//un ensemble de composants : toutes les entites qui ont exactement ces composants
+class Archetype {
+    vector<const ArchetypeColumnType *> columns; //triees par typeID
+    vector<size_t> offsets; //debut de chaque colonne dans un chunk
+    size_t chunkBytes = 0;
+    uint32_t capacity = 0; //nombre d'entites par chunk
+    vector<ArchetypeChunk> chunks;
+
+    unordered_map<uint32_t, Archetype *> addEdges, removeEdges; //cache des archetypes voisins (+1 ou -1 composant)
+
+    friend class ArchetypeStorage;
+
+public:
+    explicit Archetype(vector<const ArchetypeColumnType *> columns_in) : columns(std::move(columns_in)) {
+        size_t bytesPerEntity = sizeof(Entity);
+        for (const ArchetypeColumnType * column : columns) bytesPerEntity += column->size;
+
+        capacity = max<size_t>(1, ARCHETYPE_CHUNK_SIZE / bytesPerEntity);
+
+        //on enleve des places tant que le padding d'alignement fait deborder le chunk
+        while (true) {
+            size_t offset = capacity * sizeof(Entity);
+            offsets.clear();
+            for (const ArchetypeColumnType * column : columns) {
+                offset = (offset + column->align - 1) / column->align * column->align;
+                offsets.push_back(offset);
+                offset += capacity * column->size;
+            }
+            chunkBytes = offset;
+            if (chunkBytes <= ARCHETYPE_CHUNK_SIZE || capacity == 1) break;
+            capacity--;
+        }
+    }
+
+    ~Archetype(){
+        for (ArchetypeChunk & chunk : chunks)
+            for (uint32_t row = 0; row < chunk.count; row++)
+                for (size_t column = 0; column < columns.size(); column++)
+                    columns[column]->destroy(element(chunk, column, row));
+    }
+
+    Archetype(const Archetype &) = delete;
+    Archetype & operator=(const Archetype &) = delete;
+
+    inline int columnOf(uint32_t typeID) const {
+        for (size_t i = 0; i < columns.size(); i++)
+            if (columns[i]->typeID == typeID) return i;
+        return -1;
+    }
 
+    inline bool hasType(uint32_t typeID) const { return columnOf(typeID) != -1; }
 
-    
\ No newline at end of file
+    inline void * element(const ArchetypeChunk & chunk, size_t column, uint32_t row) const {
+        return reinterpret_cast<unsigned char *>(chunk.data.get()) + offsets[column] + row * columns[column]->size;
+    }
+
+    inline void * columnData(const ArchetypeChunk & chunk, size_t column) const { return element(chunk, column, 0); }
+
+    inline const vector<ArchetypeChunk> & getChunks() const { return chunks; }
+
+    size_t size() const {
+        return chunks.empty() ? 0 : (chunks.size() - 1) * capacity + chunks.back().count;
+    }
+};
+
+//backend archetype du Registry : chaque entity qui a au moins un composant Archetype vit dans une ligne d'un chunk
+class ArchetypeStorage {
+    struct Location {
+        Entity entity = INVALID;
+        Archetype * archetype = nullptr;
+        uint32_t chunk = 0;
+        uint32_t row = 0;
+    };
+
+    vector<unique_ptr<Archetype>> archetypes;
+    vector<Location> locations; //indexe par entityIndex
+
+    Location * find(Entity entity) {
+        uint32_t index = entityIndex(entity);
+        if (index >= locations.size() || locations[index].entity != entity) return nullptr;
+        return &locations[index];
+    }
+
+    Archetype * findOrCreate(vector<const ArchetypeColumnType *> columns) {
+        sort(columns.begin(), columns.end(), [](const ArchetypeColumnType * a, const ArchetypeColumnType * b){ return a->typeID < b->typeID; });
+        for (auto & archetype : archetypes)
+            if (archetype->columns == columns) return archetype.get();
+        archetypes.push_back(make_unique<Archetype>(std::move(columns)));
+        return archetypes.back().get();
+    }
+
+    Archetype * withType(Archetype * from, const ArchetypeColumnType & type) {
+        if (!from) return findOrCreate({&type});
+
+        auto edge = from->addEdges.find(type.typeID);
+        if (edge != from->addEdges.end()) return edge->second;
+
+        vector<const ArchetypeColumnType *> columns = from->columns;
+        columns.push_back(&type);
+        Archetype * to = findOrCreate(std::move(columns));
+        from->addEdges[type.typeID] = to;
+        to->removeEdges[type.typeID] = from;
+        return to;
+    }
+
+    Archetype * withoutType(Archetype * from, uint32_t typeID) {
+        if (from->columns.size() == 1) return nullptr; //plus aucun composant Archetype
+
+        auto edge = from->removeEdges.find(typeID);
+        if (edge != from->removeEdges.end()) return edge->second;
+
+        vector<const ArchetypeColumnType *> columns;
+        for (const ArchetypeColumnType * column : from->columns)
+            if (column->typeID != typeID) columns.push_back(column);
+        Archetype * to = findOrCreate(std::move(columns));
+        from->removeEdges[typeID] = to;
+        to->addEdges[typeID] = from;
+        return to;
+    }
+
+    //reserve une ligne a la fin du dernier chunk (en cree un si il est plein)
+    void allocate(Archetype * archetype, Location & location) {
+        if (archetype->chunks.empty() || archetype->chunks.back().count == archetype->capacity) {
+            ArchetypeChunk chunk;
+            chunk.data.reset(new max_align_t[(archetype->chunkBytes + sizeof(max_align_t) - 1) / sizeof(max_align_t)]);
+            archetype->chunks.push_back(std::move(chunk));
+        }
+        ArchetypeChunk & chunk = archetype->chunks.back();
+        location.archetype = archetype;
+        location.chunk = archetype->chunks.size() - 1;
+        location.row = chunk.count++;
+        chunk.entities()[location.row] = location.entity;
+    }
+
+    //bouche le trou laisse par une ligne deja videe avec la derniere ligne de l'archetype (swap and pop entre chunks)
+    void releaseRow(Archetype * archetype, uint32_t chunkIndex, uint32_t row) {
+        ArchetypeChunk & last = archetype->chunks.back();
+        uint32_t lastRow = last.count - 1;
+
+        if (chunkIndex != archetype->chunks.size() - 1 || row != lastRow) {
+            ArchetypeChunk & chunk = archetype->chunks[chunkIndex];
+            for (size_t column = 0; column < archetype->columns.size(); column++)
+                archetype->columns[column]->moveTo(archetype->element(chunk, column, row), archetype->element(last, column, lastRow));
+
+            Entity moved = last.entities()[lastRow];
+            chunk.entities()[row] = moved;
+            Location & movedLocation = locations[entityIndex(moved)];
+            movedLocation.chunk = chunkIndex;
+            movedLocation.row = row;
+        }
+
+        if (--last.count == 0) archetype->chunks.pop_back();
+    }
+
+    //deplace l'entity vers un autre archetype, les colonnes absentes de la destination sont detruites
+    void moveEntity(Location & location, Archetype * to) {
+        Archetype * from = location.archetype;
+        uint32_t fromChunk = location.chunk;
+        uint32_t fromRow = location.row;
+
+        if (to) allocate(to, location);
+
+        ArchetypeChunk & chunk = from->chunks[fromChunk];
+        for (size_t column = 0; column < from->columns.size(); column++) {
+            void * source = from->element(chunk, column, fromRow);
+            int destination = to ? to->columnOf(from->columns[column]->typeID) : -1;
+            if (destination != -1)
+                from->columns[column]->moveTo(to->element(to->chunks[location.chunk], destination, location.row), source);
+            else
+                from->columns[column]->destroy(source);
+        }
+
+        releaseRow(from, fromChunk, fromRow);
+
+        if (!to) location = Location{};
+    }
+
+public:
+    ArchetypeStorage() = default;
+    ArchetypeStorage(const ArchetypeStorage &) = delete;
+    ArchetypeStorage & operator=(const ArchetypeStorage &) = delete;
+
+    template<typename Component>
+    bool has(Entity entity) {
+        Location * location = find(entity);
+        return location && location->archetype->hasType(componentTypeID<Component>());
+    }
+
+    template<typename Component>
+    Component & get(Entity entity) {
+        Location * location = find(entity);
+        assert(location);
+        int column = location->archetype->columnOf(componentTypeID<Component>());
+        assert(column != -1);
+        return *static_cast<Component *>(location->archetype->element(location->archetype->chunks[location->chunk], column, location->row));
+    }
+
+    template<typename Component>
+    Component & emplace(Entity entity, Component component) {
+        const ArchetypeColumnType & type = archetypeColumnType<Component>();
+
+        Location * location = find(entity);
+        if (location && location->archetype->hasType(type.typeID)) {
+            return get<Component>(entity) = std::move(component);
+        }
+
+        if (!location) {
+            if (entityIndex(entity) >= locations.size()) locations.resize(entityIndex(entity) + 1);
+            location = &locations[entityIndex(entity)];
+            location->entity = entity;
+            allocate(withType(nullptr, type), *location);
+        } else {
+            moveEntity(*location, withType(location->archetype, type));
+        }
+
+        Archetype * archetype = location->archetype;
+        void * destination = archetype->element(archetype->chunks[location->chunk], archetype->columnOf(type.typeID), location->row);
+        return *new (destination) Component(std::move(component));
+    }
+
+    template<typename Component>
+    void remove(Entity entity) {
+        assert(has<Component>(entity));
+        Location & location = *find(entity);
+        moveEntity(location, withoutType(location.archetype, componentTypeID<Component>()));
+    }
+
+    inline bool contains(Entity entity) { return find(entity) != nullptr; }
+
+    void destroy(Entity entity) {
+        Location * location = find(entity);
+        if (location) moveEntity(*location, nullptr);
+    }
+
+    inline const vector<unique_ptr<Archetype>> & getArchetypes() const { return archetypes; }
+
+    void swap(ArchetypeStorage & other) {
+        archetypes.swap(other.archetypes);
+        locations.swap(other.locations);
+    }
+
+    //deplace toutes les lignes de other dans les archetypes equivalents d'ici, other est vide apres
+    void merge(ArchetypeStorage & other, const EntityRemap & remap) {
+        for (auto & source : other.archetypes) {
+            Archetype * target = findOrCreate(source->columns);
+
+            for (ArchetypeChunk & chunk : source->chunks) {
+                for (uint32_t row = 0; row < chunk.count; row++) {
+                    Entity entity = remap(chunk.entities()[row]);
+                    if (entityIndex(entity) >= locations.size()) locations.resize(entityIndex(entity) + 1);
+                    Location & location = locations[entityIndex(entity)];
+                    location.entity = entity;
+                    allocate(target, location);
+
+                    for (size_t column = 0; column < source->columns.size(); column++) {
+                        void * destination = target->element(target->chunks[location.chunk], column, location.row);
+                        source->columns[column]->moveTo(destination, source->element(chunk, column, row));
+                        if (source->columns[column]->remapEntities) source->columns[column]->remapEntities(destination, remap);
+                    }
+                }
+            }
+            source->chunks.clear(); //les elements ont deja ete detruits par moveTo
+        }
+        other.clear();
+    }
+
+    void clear() {
+        archetypes.clear();
+        locations.clear();
+    }
+};
+
+//parcourt les archetypes qui contiennent tous les composants demandes, chunk par chunk, sans test d'appartenance par entity
+template<typename... Components>
+class ArchetypeView {
+    vector<Archetype *> matches;
+
+    template<typename Component>
+    static inline Component * column(Archetype * archetype, const ArchetypeChunk & chunk) {
+        return static_cast<Component *>(archetype->columnData(chunk, archetype->columnOf(componentTypeID<Component>())));
+    }
+
+public:
+    explicit ArchetypeView(ArchetypeStorage & storage) {
+        for (const auto & archetype : storage.getArchetypes())
+            if ((archetype->hasType(componentTypeID<Components>()) && ...))
+                matches.push_back(archetype.get());
+    }
+
+    //func(nombre d'entites, entites, tableaux contigus de chaque composant)
+    template<typename function>
+    void eachChunk(function&& func) {
+        for (Archetype * archetype : matches)
+            for (const ArchetypeChunk & chunk : archetype->getChunks())
+                func(chunk.count, static_cast<const Entity *>(chunk.entities()), column<Components>(archetype, chunk)...);
+    }
+
+    template<typename function>
+    void each(function&& func) {
+        eachChunk([&func](uint32_t count, const Entity * entities, Components *... arrays) {
+            for (uint32_t i = 0; i < count; i++)
+                func(entities[i], arrays[i]...);
+        });
+    }
+
+    size_t size() const {
+        size_t total = 0;
+        for (Archetype * archetype : matches) total += archetype->size();
+        return total;
+    }
+};
+
+/* exemple (backend archetype) :
+    template<> struct StoragePolicy<Position> { static constexpr StorageMode mode = StorageMode::Archetype; };
+    template<> struct StoragePolicy<Velocity> { static constexpr StorageMode mode = StorageMode::Archetype; };
+
+    registry.archetypeView<Position, Velocity>().eachChunk([](uint32_t count, const Entity * entities, Position * pos, Velocity * vel) {
+        for (uint32_t i = 0; i < count; i++) pos[i].x += vel[i].dx;
+    });
+*/
+
+
+//composants declares par le systeme qui tourne sur ce thread (SystemScheduler, voir currentSystemAccess), verifies en debug par le Registry
+//has / get / changedSince et les groupes comptent comme des lectures, markChanged / patch et les composants non const d'une view comme des ecritures
+struct SystemAccess {
+    string name;
+    vector<uint32_t> reads; //tries
+    vector<uint32_t> writes;
+
+    inline bool canRead(uint32_t type) const { return binary_search(reads.begin(), reads.end(), type) || canWrite(type); }
+    inline bool canWrite(uint32_t type) const { return binary_search(writes.begin(), writes.end(), type); }
+};
+
+
+class Registry{
+
+private:
+    Entity nextEntityID = 0; //prochain index jamais utilise
+    vector<uint32_t> FreeIDs; //les index des entites qu'on a detruit pour pouvoir les reutiliser
+    vector<uint32_t> generations; //generation courante de chaque index
+    vector<uint64_t> disabledMask; //entites desactivees, voir isDisabled
+
+    vector<unique_ptr<IComponentStorage>> componentStorages; //un storage par type de composant, indexe par componentTypeID (nullptr si jamais utilise)
+
+    ArchetypeStorage archetypes; //composants dont le StoragePolicy est Archetype
+
+    vector<unique_ptr<IGroup>> groups;
+    vector<unique_ptr<IQuery>> queries; //detruites avant les storages auxquels elles sont branchees
+    vector<unique_ptr<Observer>> observers; //detruits avant les storages auxquels ils sont branches
+
+    atomic<uint32_t> currentVersion{1}; //version donnee aux ecritures en cours, 0 veut dire "jamais vu"
+
+    mutex entityLock; //protege la creation d'entites depuis plusieurs threads (reserveEntity)
+    mutex groupLock; //des systemes paralleles peuvent demander leurs groupes en meme temps
+
+    //cree le storage a la premiere demande : il doit deja exister avant d'etre utilise depuis un par_each
+    template<typename Component>
+    ComponentStorage<Component> & getComponentStorage(){
+        static_assert(!isArchetypeComponent<Component>, "ce composant est stocke dans les archetypes");
+        uint32_t type = componentTypeID<Component>();
+
+        if (type >= componentStorages.size()) componentStorages.resize(type + 1);
+        if (!componentStorages[type]) componentStorages[type] = make_unique<ComponentStorage<Component>>();
+
+        return static_cast<ComponentStorage<Component> &>(*componentStorages[type]);
+    }
+
+    //verifications en debug des acces d'un systeme du SystemScheduler
+    template<typename Component>
+    inline void checkRead() const {
+#ifndef NDEBUG
+        const SystemAccess * access = currentSystemAccess();
+        if (access && !access->canRead(componentTypeID<Component>())) {
+            fprintf(stderr, "systeme %s : lecture non declaree de %s\n", access->name.c_str(), typeid(Component).name());
+            assert(false && "composant lu sans etre declare par le systeme");
+        }
+#endif
+    }
+
+    template<typename Component>
+    inline void checkWrite() const {
+#ifndef NDEBUG
+        const SystemAccess * access = currentSystemAccess();
+        if (access && !access->canWrite(componentTypeID<Component>())) {
+            fprintf(stderr, "systeme %s : ecriture non declaree de %s\n", access->name.c_str(), typeid(Component).name());
+            assert(false && "composant ecrit sans etre declare par le systeme");
+        }
+#endif
+    }
+
+    //un systeme ne doit pas changer la structure du registry pendant que d'autres tournent : il passe par un CommandBuffer
+    inline void checkStructural() const {
+#ifndef NDEBUG
+        const SystemAccess * access = currentSystemAccess();
+        if (access) {
+            fprintf(stderr, "systeme %s : changement structurel direct, utiliser un CommandBuffer\n", access->name.c_str());
+            assert(false && "changement structurel dans un systeme");
+        }
+#endif
+    }
+
+    //acces d'une view : const T se lit, T s'ecrit
+    template<typename Component>
+    inline void checkViewAccess() const {
+        if constexpr (is_const_v<Component>) checkRead<remove_const_t<Component>>();
+        else checkWrite<Component>();
+    }
+
+    inline Entity allocateEntity() {
+        if(FreeIDs.empty()){
+            assert(nextEntityID < MAX_ENTITIES);
+            generations.push_back(0);
+            return makeEntity(nextEntityID++, 0);
+        }else{
+            uint32_t index = FreeIDs.back(); //on recup l'index du dernier element detruit, sa generation a deja ete incrementee
+            FreeIDs.pop_back();
+            return makeEntity(index, generations[index]);
+        }
+    }
+
+public:
+    inline Entity create() {
+        checkStructural();
+        return allocateEntity();
+    }
+
+    //cree count entites d'un coup dans out : les index libres d'abord, puis les nouveaux en une seule allocation
+    void create(Entity * out, size_t count) {
+        checkStructural();
+        size_t recycled = std::min(count, FreeIDs.size());
+        for (size_t i = 0; i < recycled; i++) {
+            uint32_t index = FreeIDs.back();
+            FreeIDs.pop_back();
+            out[i] = makeEntity(index, generations[index]);
+        }
+
+        assert(nextEntityID + (count - recycled) <= MAX_ENTITIES);
+        generations.resize(generations.size() + (count - recycled), 0);
+        for (size_t i = recycled; i < count; i++) {
+            out[i] = makeEntity(nextEntityID++, 0);
+        }
+    }
+
+    //comme create mais utilisable depuis plusieurs threads en meme temps (CommandBuffer)
+    //l'entity existe tout de suite, sans composant
+    inline Entity reserveEntity() {
+        lock_guard<mutex> guard(entityLock);
+        return allocateEntity();
+    }
+
+    //vrai si le handle correspond a la generation courante de son index
+    inline bool valid(Entity entity) const {
+        return entity != INVALID && entityIndex(entity) < generations.size() && generations[entityIndex(entity)] == entityGeneration(entity);
+    }
+
+    //on itere a travers tous les types de composant pour essayer de supprimer l entity
+    void destroy(Entity entity){
+        assert(valid(entity));
+        checkStructural();
+
+        for (unique_ptr<IComponentStorage> & storage : componentStorages) {
+            if (storage && storage->has(entity)) {
+                storage->remove(entity);
+            }
+        }
+        archetypes.destroy(entity);
+
+        uint32_t index = entityIndex(entity);
+        generations[index] = (generations[index] + 1) & ENTITY_GENERATION_MASK; //invalide tous les handles existants vers cet index
+        FreeIDs.push_back(index);
+        if ((index >> 6) < disabledMask.size()) disabledMask[index >> 6] &= ~(uint64_t(1) << (index & 63)); //l'index recycle repart active
+
+    }
+
+    //desactive / reactive une entity sans toucher a ses composants : les views et les groupes la sautent
+    //pas un changement structurel pour les storages, mais le bitset peut grandir : depuis un systeme, passer par un CommandBuffer
+    void setEnabled(Entity entity, bool enabled){
+        assert(valid(entity));
+        checkStructural();
+        uint32_t index = entityIndex(entity);
+        if ((index >> 6) >= disabledMask.size()) {
+            if (enabled) return;
+            disabledMask.resize((index >> 6) + 1, 0);
+        }
+        if (enabled) disabledMask[index >> 6] &= ~(uint64_t(1) << (index & 63));
+        else disabledMask[index >> 6] |= uint64_t(1) << (index & 63);
+    }
+
+    inline void enable(Entity entity) { setEnabled(entity, true); }
+    inline void disable(Entity entity) { setEnabled(entity, false); }
+    inline bool enabled(Entity entity) const { return !isDisabled(disabledMask, entity); }
+
+    template<typename Component>
+    inline bool has(Entity entity){
+        checkRead<Component>();
+        if constexpr (isArchetypeComponent<Component>) return archetypes.has<Component>(entity);
+        else return getComponentStorage<Component>().has(entity);
+    }
+
+    template<typename Component>
+    inline Component & get(Entity entity){
+        checkRead<Component>();
+        if constexpr (isArchetypeComponent<Component>) return archetypes.get<Component>(entity);
+        else return getComponentStorage<Component>().get(entity);
+    }
+
+    template<typename Component>
+    inline void remove(Entity entity){
+        checkStructural();
+
+        if constexpr (HasOnDetach<Component>::value) get<Component>(entity).onDetach(*this, entity);
+
+        if constexpr (isArchetypeComponent<Component>) archetypes.remove<Component>(entity);
+        else getComponentStorage<Component>().remove(entity);
+    }
+
+    template<typename Component, typename... Arguments>
+    Component & emplace(Entity entity, Arguments &&... arguments){ //ajoute un composant a une entite 
+        checkStructural();
+        Component * component;
+
+        if constexpr (isArchetypeComponent<Component>) {
+            component = &archetypes.emplace<Component>(entity, Component{ forward<Arguments>(arguments)... });
+        } else {
+            ComponentStorage<Component> & storage = getComponentStorage<Component>();
+
+            storage.add(entity , Component{ forward<Arguments>(arguments)... }, currentVersion ); //Component{ args } permet d'initialiser le composant
+                                                                               //forward permet de conserver les arguments (si ils sont passe par reference, on les passe par reference)
+                                                                                // si ils sont passés par copie on utilise les copies
+            component = &storage.get(entity);
+        }
+
+        if constexpr (HasOnAttach<Component>::value) component->onAttach(*this, entity);
+
+        return *component;
+    }
+
+    //cree le storage du composant s'il n'existe pas encore (a faire avant de l'utiliser depuis plusieurs threads)
+    template<typename Component>
+    void assure(){
+        if constexpr (!isArchetypeComponent<Component>) getComponentStorage<Component>();
+    }
+
+    //reordonne les composants pour les parcourir dans un ordre utile (ex: par materiau), les pointeurs vers eux ne sont plus valides
+    //compare(const T &, const T &) ou compare(Entity, Entity) ; un storage possede par un groupe se trie par le groupe
+    template<typename Component, typename Compare>
+    void sort(Compare compare){
+        static_assert(!isArchetypeComponent<Component>, "les composants Archetype sont ranges par chunks");
+        checkStructural();
+        getComponentStorage<Component>().sort(compare);
+    }
+
+    //range les composants To dans l'ordre des entites de From (ex: apres un tri de From, pour parcourir les deux ensemble)
+    template<typename To, typename From>
+    void sortAs(){
+        static_assert(!isArchetypeComponent<To> && !isArchetypeComponent<From>, "les composants Archetype sont ranges par chunks");
+        checkStructural();
+        getComponentStorage<To>().sortAs(getComponentStorage<From>().getEntities());
+    }
+
+    //rebouche les trous des storages Stable : les composants deplaces changent d'adresse,
+    //a appeler a un moment ou personne ne garde de pointeur (ex: toutes les quelques centaines de frames, apres un chargement)
+    void compact(){
+        checkStructural();
+        for (unique_ptr<IComponentStorage> & storage : componentStorages) {
+            if (storage) storage->compact();
+        }
+    }
+
+    template<typename Component>
+    void compact(){
+        checkStructural();
+        getComponentStorage<Component>().compact();
+    }
+
+    //prepare la place pour count nouveaux composants (rien a faire pour les Archetype, ils sont ranges par chunks)
+    template<typename Component>
+    void reserve(size_t count){
+        if constexpr (!isArchetypeComponent<Component>) getComponentStorage<Component>().reserveMore(count);
+    }
+
+    //suivi des modifications : chaque systeme garde la version de son dernier passage et ne traite que ce qui a change depuis
+    //  uint32_t since = lastVersion;  ... view<T>().changed<T>(since) ...  lastVersion = registry.advanceVersion();
+    //les ecritures faites pendant le systeme ont la version qu'il recupere a la fin, il ne les revoit donc pas
+
+    inline uint32_t version() const { return currentVersion.load(memory_order_relaxed); }
+
+    //termine la version courante et la renvoie, les ecritures suivantes auront une version plus grande
+    inline uint32_t advanceVersion() { return currentVersion.fetch_add(1); }
+
+    //a appeler apres avoir modifie un composant en place
+    template<typename Component>
+    inline void markChanged(Entity entity){
+        static_assert(!isArchetypeComponent<Component>, "pas de suivi des modifications pour les composants Archetype");
+        checkWrite<Component>();
+        getComponentStorage<Component>().markChanged(entity, version());
+    }
+
+    //modifie le composant avec func puis le marque comme modifie
+    template<typename Component, typename function>
+    Component & patch(Entity entity, function&& func){
+        Component & component = get<Component>(entity);
+        func(component);
+        markChanged<Component>(entity);
+        return component;
+    }
+
+    template<typename Component>
+    inline bool changedSince(Entity entity, uint32_t since){
+        checkRead<Component>();
+        return getComponentStorage<Component>().changedSince(entity, since);
+    }
+
+    template<typename Component>
+    inline bool addedSince(Entity entity, uint32_t since){
+        checkRead<Component>();
+        return getComponentStorage<Component>().addedSince(entity, since);
+    }
+
+    //voir ComponentStorage::layoutVersion
+    template<typename Component>
+    inline uint32_t layoutVersion(){
+        checkRead<Component>();
+        return getComponentStorage<Component>().layoutVersion();
+    }
+
+    //vrai si au moins un composant de ce type a change depuis since
+    template<typename Component>
+    inline bool changedSince(uint32_t since){
+        checkRead<Component>();
+        return getComponentStorage<Component>().changedSince(since);
+    }
+
+
+    //view<A, const B>() : B n'est que lu
+    template<typename... Components, typename... Excluded>
+    BasicView<Exclude<Excluded...>, Components...> view(Exclude<Excluded...> = {}) {
+        (checkViewAccess<Components>(), ...);
+        (checkRead<Excluded>(), ...);
+        return BasicView<Exclude<Excluded...>, Components...>( make_tuple( &getComponentStorage<remove_const_t<Components>>()...), make_tuple( &getComponentStorage<Excluded>()...), &disabledMask );
+    }
+
+    //file des entites qui recoivent (Construct), modifient via markChanged / patch (Update) ou perdent (Destroy) le composant
+    //a creer avant les ajouts qu'on veut voir, le registry garde l'observer jusqu'a release
+    template<typename Component>
+    Observer & observe(ObserverEvent event){
+        static_assert(!isArchetypeComponent<Component>, "pas d'observer pour les composants Archetype");
+        ComponentStorage<Component> & storage = getComponentStorage<Component>();
+        observers.push_back(make_unique<Observer>(&storage));
+        Observer * observer = observers.back().get();
+
+        auto push = [observer](Entity e){ observer->push(e); };
+        auto drop = [observer](Entity e){ observer->drop(e); };
+        switch (event) {
+            case ObserverEvent::Construct:
+                storage.constructListeners.push_back({observer, push});
+                storage.destroyListeners.push_back({observer, drop});
+                break;
+            case ObserverEvent::Update:
+                storage.updateListeners.push_back({observer, push});
+                storage.destroyListeners.push_back({observer, drop});
+                break;
+            case ObserverEvent::Destroy:
+                storage.destroyListeners.push_back({observer, push});
+                break;
+        }
+        return *observer;
+    }
+
+    void release(Observer & observer){
+        observers.erase(remove_if(observers.begin(), observers.end(), [&observer](const unique_ptr<Observer> & o){ return o.get() == &observer; }), observers.end());
+    }
+
+    //cree le groupe a la premiere demande puis renvoie toujours le meme
+    template<typename... Owned, typename... Get>
+    BasicGroup<tuple<Owned...>, With<Get...>> & group(With<Get...> = {}) {
+        using GroupType = BasicGroup<tuple<Owned...>, With<Get...>>;
+        (checkRead<Owned>(), ...);
+        (checkRead<Get>(), ...);
+
+        lock_guard<mutex> guard(groupLock);
+        for (auto & existing : groups) {
+            if (GroupType * found = dynamic_cast<GroupType *>(existing.get())) return *found;
+        }
+        groups.push_back(make_unique<GroupType>( make_tuple( &getComponentStorage<Owned>()...), make_tuple( &getComponentStorage<Get>()...), &disabledMask ));
+        return static_cast<GroupType &>(*groups.back());
+    }
+
+    //cree la requete a la premiere demande puis renvoie toujours la meme, const T veut dire qu'elle ne fait que lire T
+    template<typename... Components, typename... Excluded>
+    BasicQuery<Exclude<Excluded...>, Components...> & query(Exclude<Excluded...> = {}) {
+        using QueryType = BasicQuery<Exclude<Excluded...>, Components...>;
+        (checkViewAccess<Components>(), ...);
+        (checkRead<Excluded>(), ...);
+
+        lock_guard<mutex> guard(groupLock);
+        for (auto & existing : queries) {
+            if (QueryType * found = dynamic_cast<QueryType *>(existing.get())) return *found;
+        }
+        queries.push_back(make_unique<QueryType>( make_tuple( &getComponentStorage<remove_const_t<Components>>()...), make_tuple( &getComponentStorage<Excluded>()...), &disabledMask ));
+        return static_cast<QueryType &>(*queries.back());
+    }
+
+    //requete sur les composants Archetype : parcourt des tableaux contigus chunk par chunk
+    template<typename... Components>
+    ArchetypeView<Components...> archetypeView() {
+        static_assert((isArchetypeComponent<Components> && ...), "archetypeView ne prend que des composants Archetype");
+        return ArchetypeView<Components...>(archetypes);
+    }
+
+
+    //echange tout le contenu avec other (ex: monde construit dans un registry de chargement)
+    //les composants recus sont marques ajoutes pour que les systemes les traitent
+    void swap(Registry & other) {
+        std::swap(nextEntityID, other.nextEntityID);
+        FreeIDs.swap(other.FreeIDs);
+        generations.swap(other.generations);
+        disabledMask.swap(other.disabledMask);
+        componentStorages.swap(other.componentStorages);
+        archetypes.swap(other.archetypes);
+        groups.swap(other.groups);
+        for (unique_ptr<IGroup> & group : groups) group->setDisabledMask(&disabledMask);
+        for (unique_ptr<IGroup> & group : other.groups) group->setDisabledMask(&other.disabledMask);
+        queries.swap(other.queries);
+        for (unique_ptr<IQuery> & query : queries) query->setDisabledMask(&disabledMask);
+        for (unique_ptr<IQuery> & query : other.queries) query->setDisabledMask(&other.disabledMask);
+        observers.swap(other.observers); //les observers suivent les storages auxquels ils sont branches
+
+        //les deux registres gardent une version croissante : les lastVersion des systemes restent valables
+        uint32_t newVersion = std::max(version(), other.version()) + 1;
+        currentVersion = newVersion;
+        other.currentVersion = newVersion;
+        for (unique_ptr<IComponentStorage> & storage : componentStorages) {
+            if (storage) storage->stampAll(newVersion);
+        }
+    }
+
+    //deplace toutes les entites de other ici sous de nouveaux handles, other est vide apres
+    //renvoie la table ancien index -> nouveau handle, onAttach n'est pas rappele (les composants sont deja attaches)
+    vector<Entity> merge(Registry & other) {
+        vector<bool> freed(other.generations.size(), false);
+        for (uint32_t index : other.FreeIDs) freed[index] = true;
+
+        vector<Entity> remap(other.generations.size(), INVALID);
+        for (uint32_t index = 0; index < other.generations.size(); index++) {
+            if (!freed[index]) remap[index] = create();
+        }
+
+        EntityRemap remapEntity = [&](Entity entity){ return other.valid(entity) ? remap[entityIndex(entity)] : INVALID; };
+
+        other.groups.clear(); //inutile de reordonner les storages qu'on vide
+        other.queries.clear();
+
+        for (uint32_t type = 0; type < other.componentStorages.size(); type++) {
+            if (!other.componentStorages[type]) continue;
+            if (type >= componentStorages.size()) componentStorages.resize(type + 1);
+            if (!componentStorages[type]) componentStorages[type] = other.componentStorages[type]->makeEmpty();
+            other.componentStorages[type]->moveInto(*componentStorages[type], remapEntity, version());
+        }
+        archetypes.merge(other.archetypes, remapEntity);
+
+        for (uint32_t index = 0; index < other.generations.size(); index++) {
+            if (remap[index] != INVALID && isDisabled(other.disabledMask, makeEntity(index, 0))) setEnabled(remap[index], false);
+        }
+
+        other.clear();
+        return remap;
+    }
+
+    void clear() {
+        groups.clear();
+        queries.clear();
+        observers.clear();
+        componentStorages.clear();
+        archetypes.clear();
+        FreeIDs.clear();
+        generations.clear();
+        disabledMask.clear();
+        nextEntityID = 0;
+    }
+
+
+
+};
+
+//enregistre des changements structurels (create / destroy / emplace / remove) pendant un parcours,
+//y compris depuis les threads d'un par_each, et les applique d'un coup avec flush() hors de toute view
+//flush regroupe par storage : d'abord tous les remove, puis tous les emplace (une seule reallocation par storage),
+//puis les enable / disable, puis les destroy
+class CommandBuffer {
+
+    struct ICommandQueue {
+        virtual ~ICommandQueue() = default;
+        virtual void applyRemoves(Registry & registry) = 0;
+        virtual void applyEmplaces(Registry & registry) = 0;
+    };
+
+    template<typename Component>
+    struct CommandQueue : ICommandQueue {
+        vector<pair<Entity, Component>> emplaces;
+        vector<Entity> removes;
+
+        void applyRemoves(Registry & registry) override {
+            sort(removes.begin(), removes.end());
+            removes.erase(unique(removes.begin(), removes.end()), removes.end());
+            for (Entity entity : removes) {
+                if (registry.valid(entity) && registry.has<Component>(entity)) registry.remove<Component>(entity);
+            }
+            removes.clear();
+        }
+
+        void applyEmplaces(Registry & registry) override {
+            //tri par index pour remplir le storage dans l'ordre, stable pour que le dernier emplace d'une entity gagne
+            stable_sort(emplaces.begin(), emplaces.end(), [](const pair<Entity, Component> & a, const pair<Entity, Component> & b){
+                return entityIndex(a.first) < entityIndex(b.first);
+            });
+            registry.reserve<Component>(emplaces.size());
+            for (pair<Entity, Component> & command : emplaces) {
+                if (registry.valid(command.first)) registry.emplace<Component>(command.first, std::move(command.second));
+            }
+            emplaces.clear();
+        }
+    };
+
+    Registry & registry;
+    mutex lock;
+    vector<unique_ptr<ICommandQueue>> queues; //indexe par componentTypeID, nullptr si le type n'a jamais ete utilise
+    vector<uint32_t> usedQueues; //types qui ont des commandes en attente, dans l'ordre d'arrivee
+    vector<pair<Entity, bool>> enables; //entity, active
+    vector<Entity> destroys;
+
+    template<typename Component>
+    CommandQueue<Component> & queue(){ //lock doit etre pris
+        uint32_t type = componentTypeID<Component>();
+        if (type >= queues.size()) queues.resize(type + 1);
+        if (!queues[type]) queues[type] = make_unique<CommandQueue<Component>>();
+        if (find(usedQueues.begin(), usedQueues.end(), type) == usedQueues.end()) usedQueues.push_back(type);
+        return static_cast<CommandQueue<Component> &>(*queues[type]);
+    }
+
+public:
+    explicit CommandBuffer(Registry & registry) : registry(registry) {}
+
+    CommandBuffer(const CommandBuffer &) = delete;
+    CommandBuffer & operator=(const CommandBuffer &) = delete;
+
+    //l'entity est creee tout de suite (sans composant), ses composants arrivent au flush
+    Entity create(){
+        return registry.reserveEntity();
+    }
+
+    void destroy(Entity entity){
+        lock_guard<mutex> guard(lock);
+        destroys.push_back(entity);
+    }
+
+    template<typename Component, typename... Arguments>
+    void emplace(Entity entity, Arguments &&... arguments){
+        Component component{ forward<Arguments>(arguments)... }; //construit hors du lock
+        lock_guard<mutex> guard(lock);
+        queue<Component>().emplaces.emplace_back(entity, std::move(component));
+    }
+
+    template<typename Component>
+    void remove(Entity entity){
+        lock_guard<mutex> guard(lock);
+        queue<Component>().removes.push_back(entity);
+    }
+
+    void setEnabled(Entity entity, bool enabled){
+        lock_guard<mutex> guard(lock);
+        enables.emplace_back(entity, enabled);
+    }
+
+    inline void enable(Entity entity) { setEnabled(entity, true); }
+    inline void disable(Entity entity) { setEnabled(entity, false); }
+
+    bool empty(){
+        lock_guard<mutex> guard(lock);
+        return usedQueues.empty() && enables.empty() && destroys.empty();
+    }
+
+    //applique toutes les commandes, a appeler hors de tout parcours de view / groupe
+    void flush(){
+        lock_guard<mutex> guard(lock);
+
+        for (uint32_t type : usedQueues) queues[type]->applyRemoves(registry);
+        for (uint32_t type : usedQueues) queues[type]->applyEmplaces(registry);
+        usedQueues.clear();
+
+        for (const pair<Entity, bool> & command : enables) { //dans l'ordre d'arrivee, le dernier gagne
+            if (registry.valid(command.first)) registry.setEnabled(command.first, command.second);
+        }
+        enables.clear();
+
+        sort(destroys.begin(), destroys.end());
+        destroys.erase(unique(destroys.begin(), destroys.end()), destroys.end());
+        for (Entity entity : destroys) {
+            if (registry.valid(entity)) registry.destroy(entity);
+        }
+        destroys.clear();
+    }
+};
+
+/* exemple :
+    CommandBuffer commands(registry);
+
+    registry.view<const Position, Health>().par_each([&](Entity e, const Position & pos, Health & health) {
+        if (health.value <= 0) commands.destroy(e);
+        else if (health.value < 10) commands.emplace<Smoke>(commands.create(), pos);
+    });
+
+    commands.flush();
+*/
@@ -0,0 +1,37 @@
+#include "FixedTimestep.hpp"
+#include "Stats.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+static const Stats::Id stepStat = Stats::getInstance().counter("pas de simulation");
+static const Stats::Id droppedStat = Stats::getInstance().counter("pas de simulation abandonnes");
+
+FixedTimestep::FixedTimestep(double step, int maxSteps) : stepDuration(step), maxSteps(std::max(maxSteps, 1)) {}
+
+void FixedTimestep::accumulate(double frameTime) {
+    accumulator += std::max(frameTime, 0.0);
+
+    // frame trop longue (chargement, point d'arret, machine surchargee) : on ne rattrape pas plus de maxSteps pas,
+    // la fraction du pas en cours est gardee pour que l'interpolation reste continue
+    const double maxBacklog = maxSteps * stepDuration;
+    if (accumulator >= maxBacklog + stepDuration) {
+        const double dropped = std::floor((accumulator - maxBacklog) / stepDuration);
+        accumulator -= dropped * stepDuration;
+        Stats::getInstance().add(droppedStat, int64_t(dropped));
+    }
+}
+
+bool FixedTimestep::step() {
+    if (accumulator < stepDuration) return false;
+    accumulator -= stepDuration;
+    time += stepDuration;
+    Stats::getInstance().add(stepStat);
+    return true;
+}
+
+void FixedTimestep::setStep(double step) {
+    // meme position relative entre deux pas, pour ne pas faire sauter l'interpolation
+    accumulator = accumulator / stepDuration * step;
+    stepDuration = step;
+}
@@ -0,0 +1,34 @@
+#ifndef FIXEDTIMESTEP_HPP
+#define FIXEDTIMESTEP_HPP
+
+// Horloge de simulation a pas fixe, independante de la frequence d'affichage :
+// le temps reel de chaque frame s'accumule, la simulation avance par pas de getStep() secondes
+// et le rendu interpole entre les deux derniers pas avec getAlpha().
+//
+//     timestep.accumulate(deltaTime);
+//     while (timestep.step()) simuler(timestep.getTime());
+//     dessiner(timestep.getAlpha());
+class FixedTimestep {
+public:
+    // maxSteps : pas simules au plus par frame, le retard au-dela est abandonne (la simulation ralentit au lieu de s'emballer)
+    explicit FixedTimestep(double step = 1.0 / 60.0, int maxSteps = 4);
+
+    void accumulate(double frameTime);
+
+    // vrai tant qu'il reste un pas a simuler pour cette frame, getTime() est alors le temps de ce pas
+    bool step();
+
+    double getStep() const { return stepDuration; }
+    double getTime() const { return time; } // temps simule, en secondes
+    float getAlpha() const { return float(accumulator / stepDuration); } // position entre le pas precedent (0) et le dernier (1)
+
+    void setStep(double step);
+
+private:
+    double stepDuration;
+    int maxSteps;
+    double accumulator = 0; // temps reel pas encore simule
+    double time = 0;
+};
+
+#endif // FIXEDTIMESTEP_HPP
@@ -14,6 +14,7 @@
 #include "ImGuiHelper.hpp"
 #include "ImGuiConsole.hpp"
 #include "SceneRenderer.hpp"
+#include "Stats.hpp"
 
 
 
@@ -109,6 +110,7 @@ void renderImGui() {
             ImGui::DockBuilderDockWindow("Hiérarchie", dock_left_id);
             ImGui::DockBuilderDockWindow("Propriétés", dock_right_id);
             ImGui::DockBuilderDockWindow("Console", dock_bottom_id);
+            ImGui::DockBuilderDockWindow("Statistiques", dock_bottom_id);
             
             ImGui::DockBuilderFinish(dockspace_id);
         }
@@ -130,6 +132,16 @@ void renderImGui() {
         Console::getInstance().displayLogs();
     }
     ImGui::End();
+
+    if (ImGui::Begin("Statistiques")) {
+        // derniere frame, moyenne / max sur l'historique, et la courbe de l'historique (tampon circulaire)
+        for (const Stats::Series& stat : Stats::getInstance().getSeries()) {
+            ImGui::Text("%-28s %10.3f  moy %10.3f  max %10.3f%s", stat.name.c_str(), stat.last, stat.average(), stat.max(), stat.isTimer ? " ms" : "");
+            ImGui::PlotLines(("##" + stat.name).c_str(), stat.history.data(), int(stat.frames),
+                             stat.frames == Stats::HISTORY_SIZE ? int(stat.head) : 0, nullptr, 0.0f, FLT_MAX, ImVec2(0.0f, 30.0f));
+        }
+    }
+    ImGui::End();
     
     if (ImGui::Begin("Vue Scène")) {
         ImGui::Text("FPS: %.1f", ImGui::GetIO().Framerate);
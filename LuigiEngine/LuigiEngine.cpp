@@ -24,8 +24,13 @@ using namespace std;
 #include "common/shader.hpp"
 
 #include "ECS.h"
+#include "FixedTimestep.hpp"
+#include "Prefab.hpp"
 #include "RenderSystem.hpp"
 #include "SceneCamera.hpp"
+#include "ShaderProgram.hpp"
+#include "Stats.hpp"
+#include "SystemScheduler.hpp"
 #include "Transform.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -58,15 +63,14 @@ double lastFrame;
 double timeSinceKeyPressed = 0.0f;
 int refreshrateMode = 1; // 1 = V-Sync  0 = inf
 bool paused = false;
+FixedTimestep simulationClock(1.0 / 60.0); // la simulation avance par pas fixes, le rendu interpole entre les deux derniers
 
 // debug
 double startTime;
 int nbFrames = 0;
 bool* optimizeMVP = new bool(true);
-int* nbLocalMatrixUpdate;
-int* nbGlobalMatrixUpdate;
-int* nbMVPUpdate;
-int* nbViewProjUpdate;
+Stats& stats = Stats::getInstance(); // compteurs et chronos, remis a zero a chaque frame par endFrame
+const Stats::Id frameTimer = stats.timer("frame (CPU)");
 
 // déplacement selon heightmap
 unsigned char* heightmapData;
@@ -173,18 +177,19 @@ int main()
 
     /****************************************/
 
-    TransformSystem transformSystem;
+    TransformSystem transformSystem(registry); // avant les entites : il observe les changements de hierarchie
     renderSystem = RenderSystem();
     CameraSystem cameraSystem = CameraSystem();
+    TextureSystem textureSystem(registry); // avant les meshes : il observe leurs ajouts
 
     Mesh* sphereLOD1 = new Mesh("models/sphereLOD1.obj");
     Mesh* sphereLOD2 = new Mesh("models/sphereLOD2.obj");
 
     Mesh* suzanneLOD1 = new Mesh("models/suzanneLOD1.obj");
 
-    GLuint simpleShaders = LoadShaders("shaders/vertex.glsl", "shaders/fragment.glsl");
-    GLuint pbrShaders = LoadShaders("shaders/vertex_pbr.glsl", "shaders/fragment_pbr.glsl");
-    GLuint terrainShaders = LoadShaders("shaders/vertex_terrain.glsl", "shaders/fragment_terrain.glsl");
+    ShaderProgram* simpleShaders = new ShaderProgram("shaders/vertex.glsl", "shaders/fragment.glsl");
+    ShaderProgram* pbrShaders = new ShaderProgram("shaders/vertex_pbr.glsl", "shaders/fragment_pbr.glsl");
+    ShaderProgram* terrainShaders = new ShaderProgram("shaders/vertex_terrain.glsl", "shaders/fragment_terrain.glsl");
 
     Mesh terrainMeshLOD1;
     createFlatTerrain({128, 128}, terrainSize, terrainMeshLOD1.vertices, terrainMeshLOD1.triangles, terrainMeshLOD1.uvs);
@@ -216,11 +221,6 @@ int main()
         {20, &terrainMeshLOD4}, {25, &terrainMeshLOD5}, {30, &terrainMeshLOD6}},
         terrainShaders,{terrainHeightmap, "snowrock.png", "rock.png", "grass.png"},
         {"heightmap_tex", "snowrock_tex", "rock_tex", "grass_tex"});
-    MeshComponent sphereBrickMeshComponent = MeshComponent({{0, sphereLOD1}, {10, sphereLOD2}}, pbrShaders, {}, {}, "brick", "interior");
-    MeshComponent sphereMetalMeshComponent = MeshComponent({{0, sphereLOD1}, {10, sphereLOD2}}, pbrShaders, {}, {}, "metal", "interior");
-    MeshComponent sphereWoodMeshComponent = MeshComponent({{0, sphereLOD1}, {10, sphereLOD2}}, pbrShaders, {}, {}, "wood", "interior");
-    MeshComponent sphereRustMeshComponent = MeshComponent({{0, sphereLOD1}, {10, sphereLOD2}}, pbrShaders, {}, {}, "rust", "interior");
-    MeshComponent sphereWhiteballMeshComponent = MeshComponent({{0, sphereLOD1}, {10, sphereLOD2}}, pbrShaders, {}, {}, "whiteball", "interior");
 
     cameraWorldSideEntity = registry.create();
     cameraWorldUpEntity = registry.create();
@@ -229,21 +229,11 @@ int main()
     Entity earthEntity = registry.create();
     Entity moonEntity = registry.create();
     Entity terrainEntity = registry.create();
-    Entity sphereBrickEntity = registry.create();
-    Entity sphereMetalEntity = registry.create();
-    Entity sphereWoodEntity = registry.create();
-    Entity sphereRustEntity = registry.create();
-    Entity sphereWhiteballEntity = registry.create();
 
     registry.emplace<MeshComponent>(sunEntity,sunMeshComponent);
     registry.emplace<MeshComponent>(earthEntity, earthMeshComponent);
     registry.emplace<MeshComponent>(moonEntity, moonMeshComponent);
     registry.emplace<MeshComponent>(terrainEntity, terrainMeshComponent);
-    registry.emplace<MeshComponent>(sphereBrickEntity, sphereBrickMeshComponent);
-    registry.emplace<MeshComponent>(sphereMetalEntity, sphereMetalMeshComponent);
-    registry.emplace<MeshComponent>(sphereWoodEntity, sphereWoodMeshComponent);
-    registry.emplace<MeshComponent>(sphereRustEntity, sphereRustMeshComponent);
-    registry.emplace<MeshComponent>(sphereWhiteballEntity, sphereWhiteballMeshComponent);
 
     // Projection matrix : 45 Field of View, 4:3 ratio, display range : 0.1 unit <-> 100 units
     mat4 pers = perspective(radians(45.0f), 1.0f * SCR_WIDTH / SCR_HEIGHT, 0.1f, 1000.0f);
@@ -259,14 +249,8 @@ int main()
     registry.emplace<Transform>(cameraWorldUpEntity).addPos({0, 50, 0});
     registry.get<Transform>(cameraWorldUpEntity).setRot(quat({-M_PI/2, 0, 0}));
     registry.emplace<Transform>(cameraEarthEntity).addPos({0, .25, 3});
-    // TODO bug si pas dans le bon ordre !!!
     registry.emplace<Transform>(earthEntity).setPos({5, 0, 0});
     registry.emplace<Transform>(terrainEntity).setPos({-1, -.75, 0});
-    registry.emplace<Transform>(sphereBrickEntity).setPos({-.85, .35, 1});
-    registry.emplace<Transform>(sphereMetalEntity).setPos({-.425, .35, 1});
-    registry.emplace<Transform>(sphereWoodEntity).setPos({0, .35, 1});
-    registry.emplace<Transform>(sphereRustEntity).setPos({.425, .35, 1});
-    registry.emplace<Transform>(sphereWhiteballEntity).setPos({.85, .35, 1});
     registry.emplace<Transform>(moonEntity).setPos({5, 0, 0});
     registry.emplace<Transform>(sunEntity).setPos({0, 0, 0});
 
@@ -274,15 +258,31 @@ int main()
     registry.get<Transform>(earthEntity).setScale(vec3(0.5));
     registry.get<Transform>(moonEntity).setScale(vec3(1737.0 / 6378));
     registry.get<Transform>(terrainEntity).setScale(vec3(2));
-    registry.get<Transform>(sphereBrickEntity).setScale(vec3(.2));
-    registry.get<Transform>(sphereMetalEntity).setScale(vec3(.2));
-    registry.get<Transform>(sphereWoodEntity).setScale(vec3(.2));
-    registry.get<Transform>(sphereRustEntity).setScale(vec3(.2));
-    registry.get<Transform>(sphereWhiteballEntity).setScale(vec3(.2));
 
-    registry.emplace<Hierarchy>(earthEntity, sunEntity, vector{moonEntity, terrainEntity, sphereBrickEntity, sphereMetalEntity, sphereWoodEntity, sphereRustEntity, sphereWhiteballEntity});
+    registry.emplace<Hierarchy>(earthEntity, sunEntity, vector{moonEntity, terrainEntity});
     registry.emplace<Hierarchy>(cameraEarthEntity, earthEntity, vector<Entity>{});
 
+    // les entites dessinees et les cameras sont interpolees entre deux pas de simulation
+    for (Entity entity : {sunEntity, earthEntity, moonEntity, terrainEntity, cameraWorldSideEntity, cameraWorldUpEntity, cameraEarthEntity}) {
+        registry.emplace<PreviousTransform>(entity);
+    }
+
+    // rangee de spheres PBR : la premiere sert de modele (Transform, PreviousTransform) aux autres, copiees par un Prefab,
+    // puis chacune recoit son materiau et s'accroche a la Terre
+    const vector<string> sphereMaterials = {"brick", "metal", "wood", "rust", "whiteball"};
+    vector<Entity> sphereEntities = {registry.create()};
+    registry.emplace<Transform>(sphereEntities[0]).setPos({-.85, .35, 1});
+    registry.get<Transform>(sphereEntities[0]).setScale(vec3(.2));
+    registry.emplace<PreviousTransform>(sphereEntities[0]);
+    vector<Entity> sphereCopies = Prefab(registry, sphereEntities[0]).instantiate(registry, sphereMaterials.size() - 1, [](size_t i, Transform& transform) {
+        transform.setPos({-.425f + .425f * i, .35f, 1});
+    });
+    sphereEntities.insert(sphereEntities.end(), sphereCopies.begin(), sphereCopies.end());
+    for (size_t i = 0; i < sphereEntities.size(); i++) {
+        registry.emplace<MeshComponent>(sphereEntities[i], MeshComponent({{0, sphereLOD1}, {10, sphereLOD2}}, pbrShaders, {}, {}, sphereMaterials[i], "interior"));
+        registry.emplace<Hierarchy>(sphereEntities[i], earthEntity, vector<Entity>{});
+    }
+
     Console& console = Console::getInstance();
 
     initImGui(window);
@@ -290,8 +290,26 @@ int main()
     if (!sceneRenderer.setupFramebuffer(SCR_WIDTH, SCR_HEIGHT, 1.0f)) {
         console.addLog("Failed to initialize Scene Renderer");
     }
+
+    // systemes d'un pas de simulation, executes 0, 1 ou plusieurs fois par frame
+    SystemScheduler simulation(registry);
+    simulation.add("transform", Reads<Hierarchy>{}, Writes<Transform, PreviousTransform>{}, [&](Registry& r) {
+        transformSystem.par_update(r);
+    });
+
+    // systemes de la frame : l'ordre d'ajout decide entre deux systemes qui touchent aux memes composants
+    SystemScheduler scheduler(registry);
+    scheduler.add("camera", Reads<Transform, PreviousTransform>{}, Writes<CameraComponent>{}, [&](Registry& r) {
+        cameraSystem.computeViewProj(r);
+    });
+    scheduler.add("render", Reads<Transform, PreviousTransform, CameraComponent, TextureComponent>{}, Writes<MeshComponent>{}, [&](Registry& r) {
+        if (sceneRenderer.isInitialized())
+            if (!sceneRenderer.render(deltaTime, paused, renderSystem, r))
+                console.addLog("Scene Renderer error");
+    }, true); // OpenGL : thread principal
  
     lastFrame = glfwGetTime();
+    int framesSinceCompaction = 0;
 
     do {
         // Measure speed
@@ -307,34 +325,46 @@ int main()
         // Inputs
         processInput(window);
 
-        // Debug
-        nbLocalMatrixUpdate = new int(0);
-        nbGlobalMatrixUpdate = new int(0);
-        nbMVPUpdate = new int(0);
-        nbViewProjUpdate = new int(0);
+        auto frameStart = chrono::steady_clock::now();
 
         // Clear the screen
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        vec3 rotationAngles = vec3(0.0f, currentFrame, 0.0f); 
-        quat rotationQuat = quat(rotationAngles);
-        registry.get<Transform>(sunEntity).setRot(rotationQuat);
+        textureSystem.update(registry); // ajoute des composants : hors du scheduler
+        renderSystem.sortDrawOrder(registry); // reordonne des storages : hors du scheduler aussi
 
-        rotationAngles = vec3(0.0f, currentFrame * 8, 0.0f); 
-        rotationQuat = quat(rotationAngles);
-        registry.get<Transform>(earthEntity).setRot(rotationQuat);
+        // simulation a pas fixe : les animations dependent du temps simule, pas de la frequence d'affichage
+        simulationClock.accumulate(paused ? 0.0 : deltaTime);
+        while (simulationClock.step()) {
+            const float simulationTime = float(simulationClock.getTime());
 
-        rotationAngles = vec3(0.0f, currentFrame * 5, 0.0f); 
-        rotationQuat = quat(rotationAngles);
-        registry.get<Transform>(moonEntity).setRot(rotationQuat);
+            vec3 rotationAngles = vec3(0.0f, simulationTime, 0.0f);
+            quat rotationQuat = quat(rotationAngles);
+            registry.patch<Transform>(sunEntity, [&](Transform& transform) { transform.setRot(rotationQuat); });
 
-        transformSystem.update(registry);
-        cameraSystem.update(registry);
-        cameraSystem.computeViewProj(registry);
+            rotationAngles = vec3(0.0f, simulationTime * 8, 0.0f);
+            rotationQuat = quat(rotationAngles);
+            registry.patch<Transform>(earthEntity, [&](Transform& transform) { transform.setRot(rotationQuat); });
 
-        if (sceneRenderer.isInitialized())
-            if (!sceneRenderer.render(deltaTime, paused, renderSystem, registry))
-                console.addLog("Scene Renderer error");
+            rotationAngles = vec3(0.0f, simulationTime * 5, 0.0f);
+            rotationQuat = quat(rotationAngles);
+            registry.patch<Transform>(moonEntity, [&](Transform& transform) { transform.setRot(rotationQuat); });
+
+            simulation.run();
+        }
+
+        // rendu entre les deux derniers pas
+        cameraSystem.alpha = renderSystem.alpha = simulationClock.getAlpha();
+        scheduler.run();
+
+        // les storages Stable gardent leurs trous pour que les pointeurs restent valides, on les rebouche de temps en temps
+        if (++framesSinceCompaction >= 600) {
+            registry.compact();
+            framesSinceCompaction = 0;
+        }
+
+        stats.addTime(frameTimer, chrono::steady_clock::now() - frameStart);
+        stats.endFrame();
 
         // Clear the screen
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -442,16 +472,13 @@ void processInput(GLFWwindow *window)
         cout << "Time : " << glfwGetTime() - startTime << endl;
         cout << "FPS : " << nbFrames/(glfwGetTime() - startTime) << endl;
         cout << "Delta time : " << deltaTime * 1000 << endl;
-        cout << "----- Calcul de matrice par frame (OPTI: " << *optimizeMVP << ") -----" << endl;
-        cout << *nbLocalMatrixUpdate << " calculs de matrice modèle LOCALE" << endl;
-        cout << *nbGlobalMatrixUpdate << " calculs de matrice modèle GLOBALE" << endl;
-        cout << *nbViewProjUpdate << " calculs de matrice VIEW-PROJECTION" << endl;
-        cout << *nbMVPUpdate << " calculs de matrice MVP" << endl;
+        cout << "----- Statistiques par frame (OPTI: " << *optimizeMVP << ") -----" << endl;
+        stats.dump(cout);
         cout << "----------" << endl;
         timeSinceKeyPressed = 0.0;
     }
     if (glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS && timeSinceKeyPressed >= 1.0f) {
-        optimizeMVP = new bool(!*optimizeMVP);
+        *optimizeMVP = !*optimizeMVP;
         cout << "Switched MVP optimization." << endl;
         timeSinceKeyPressed = 0.0;
     }
@@ -463,6 +490,12 @@ void processInput(GLFWwindow *window)
         timeSinceKeyPressed = 0;
     }
 
+    if (glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS && timeSinceKeyPressed >= 1.0f) {
+        simulationClock.setStep(simulationClock.getStep() > 1.0 / 100.0 ? 1.0 / 120.0 : 1.0 / 60.0);
+        cout << "Simulation step set to " << int(1.0 / simulationClock.getStep() + 0.5) << " Hz." << endl;
+        timeSinceKeyPressed = 0.0;
+    }
+
     if (glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS && timeSinceKeyPressed >= 1.0f) {
         if (refreshrateMode) {
             refreshrateMode = 0;
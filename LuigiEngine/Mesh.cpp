@@ -7,6 +7,37 @@
 using namespace std;
 using namespace glm;
 
+const MeshBuffers& Mesh::getBuffers() {
+    if (buffers.vertex) return buffers;
+
+    glGenBuffers(1, &buffers.vertex);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers.vertex);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(vec3), vertices.data(), GL_STATIC_DRAW);
+
+    glGenBuffers(1, &buffers.normal);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers.normal);
+    glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(vec3), normals.data(), GL_STATIC_DRAW);
+
+    glGenBuffers(1, &buffers.uv);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers.uv);
+    glBufferData(GL_ARRAY_BUFFER, uvs.size() * sizeof(vec2), uvs.data(), GL_STATIC_DRAW);
+
+    glGenBuffers(1, &buffers.element);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.element);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, triangles.size() * sizeof(unsigned int), triangles.data(), GL_STATIC_DRAW);
+
+    return buffers;
+}
+
+void Mesh::clearBuffers() {
+    if (!buffers.vertex) return;
+    glDeleteBuffers(1, &buffers.vertex);
+    glDeleteBuffers(1, &buffers.normal);
+    glDeleteBuffers(1, &buffers.uv);
+    glDeleteBuffers(1, &buffers.element);
+    buffers = MeshBuffers();
+}
+
 void loadOBJ(const char* fileName, vector<vec3>& vertices, vector<vec3>& normals,
              vector<vec2>& uvs, vector<unsigned int>& triangles)
 {
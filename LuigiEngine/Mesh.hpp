@@ -4,6 +4,7 @@
 #include <vector>
 #include <string>
 #include "glm/glm.hpp" 
+#include <GL/glew.h>
 
 
 
@@ -20,11 +21,25 @@ void loadOBJ(const char* fileName, vector<vec3>& vertices, vector<vec3>& normals
              vector<vec2>& uvs, vector<unsigned int>& triangles);
 
 
+// buffers OpenGL d'un Mesh : crees une seule fois et partages par tous les MeshComponent qui l'affichent
+struct MeshBuffers {
+    GLuint vertex = 0;
+    GLuint normal = 0;
+    GLuint uv = 0;
+    GLuint element = 0;
+};
+
 struct Mesh {
     vector<vec3> vertices;
     vector<vec3> normals;
     vector<vec2> uvs;
     vector<unsigned int> triangles;
+    MeshBuffers buffers; // vides tant que getBuffers n'a pas ete appele
+
+    // envoie les sommets a OpenGL au premier appel (thread OpenGL), renvoie ensuite les memes buffers
+    const MeshBuffers& getBuffers();
+    // a appeler avant de detruire le Mesh si ses buffers ont ete crees (pas dans le destructeur : le contexte peut deja etre detruit)
+    void clearBuffers();
 
  
     Mesh() = default;
@@ -0,0 +1,96 @@
+#include "Prefab.hpp"
+
+using namespace std;
+
+Prefab::Prefab(Registry& registry, Entity root) {
+    capture(registry, root, -1);
+}
+
+void Prefab::capture(Registry& registry, Entity entity, int parent) {
+    uint32_t index = nodes.size();
+    nodes.emplace_back();
+    nodes[index].parent = parent;
+    if (parent != -1) nodes[parent].children.push_back(index);
+
+    if (registry.has<Transform>(entity)) nodes[index].transform = registry.get<Transform>(entity);
+    nodes[index].interpolated = registry.has<PreviousTransform>(entity);
+    if (registry.has<MeshComponent>(entity)) nodes[index].mesh = registry.get<MeshComponent>(entity);
+    if (registry.has<TextureComponent>(entity)) nodes[index].texture = registry.get<TextureComponent>(entity);
+
+    if (registry.has<Hierarchy>(entity)) {
+        nodes[index].hasHierarchy = true;
+        vector<Entity> children = registry.get<Hierarchy>(entity).children; // copie : nodes peut etre realloue pendant la recursion
+        for (Entity child : children) {
+            capture(registry, child, index);
+        }
+    }
+}
+
+vector<Entity> Prefab::instantiate(Registry& registry, size_t count, const function<void(size_t, Transform&)>& place) const {
+    const size_t nodeCount = nodes.size();
+
+    // toutes les entites d'un coup : la copie i occupe entities[i * nodeCount, (i + 1) * nodeCount)
+    vector<Entity> entities(count * nodeCount);
+    registry.create(entities.data(), entities.size());
+
+    size_t transforms = 0, hierarchies = 0, interpolated = 0, meshes = 0, textures = 0;
+    for (const Node& node : nodes) {
+        transforms += node.transform.has_value();
+        hierarchies += node.hasHierarchy;
+        interpolated += node.interpolated;
+        meshes += node.mesh.has_value();
+        textures += node.texture.has_value();
+    }
+
+    // un storage apres l'autre, avec une seule reservation chacun
+    registry.reserve<Transform>(transforms * count);
+    for (size_t i = 0; i < count; i++) {
+        for (size_t n = 0; n < nodeCount; n++) {
+            if (!nodes[n].transform) continue;
+            Transform& transform = registry.emplace<Transform>(entities[i * nodeCount + n], *nodes[n].transform);
+            if (n == 0 && place) place(i, transform);
+        }
+    }
+
+    // les liens sont deja connus : on cree la Hierarchy sans parent pour que onAttach ne rajoute pas l'enfant une seconde fois
+    registry.reserve<Hierarchy>(hierarchies * count);
+    for (size_t i = 0; i < count; i++) {
+        const Entity* instance = &entities[i * nodeCount];
+        for (size_t n = 0; n < nodeCount; n++) {
+            if (!nodes[n].hasHierarchy && nodes[n].parent == -1) continue;
+
+            vector<Entity> children;
+            children.reserve(nodes[n].children.size());
+            for (uint32_t child : nodes[n].children) children.push_back(instance[child]);
+
+            Hierarchy& hierarchy = registry.emplace<Hierarchy>(instance[n], std::move(children));
+            if (nodes[n].parent != -1) hierarchy.parent = instance[nodes[n].parent];
+        }
+    }
+
+    registry.reserve<PreviousTransform>(interpolated * count);
+    for (size_t i = 0; i < count; i++) {
+        for (size_t n = 0; n < nodeCount; n++) {
+            if (nodes[n].interpolated) registry.emplace<PreviousTransform>(entities[i * nodeCount + n]);
+        }
+    }
+
+    // les textures avant les meshes : le TextureSystem ne recree pas le TextureComponent et garde les textures deja chargees
+    registry.reserve<TextureComponent>(textures * count);
+    for (size_t i = 0; i < count; i++) {
+        for (size_t n = 0; n < nodeCount; n++) {
+            if (nodes[n].texture) registry.emplace<TextureComponent>(entities[i * nodeCount + n], *nodes[n].texture);
+        }
+    }
+
+    registry.reserve<MeshComponent>(meshes * count);
+    for (size_t i = 0; i < count; i++) {
+        for (size_t n = 0; n < nodeCount; n++) {
+            if (nodes[n].mesh) registry.emplace<MeshComponent>(entities[i * nodeCount + n], *nodes[n].mesh);
+        }
+    }
+
+    vector<Entity> roots(count);
+    for (size_t i = 0; i < count; i++) roots[i] = entities[i * nodeCount];
+    return roots;
+}
@@ -0,0 +1,51 @@
+#ifndef PREFAB_H
+#define PREFAB_H
+
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include "ECS.h"
+#include "SceneMesh.hpp"
+#include "Transform.hpp"
+
+// Copie d'un sous-arbre d'entites (Transform, Hierarchy, PreviousTransform, MeshComponent, TextureComponent)
+// qu'on peut instancier plusieurs fois d'un coup.
+// Les copies partagent les buffers et textures OpenGL de l'original : rien n'est recharge.
+class Prefab {
+public:
+    // capture root et tous ses descendants (via Hierarchy::children)
+    Prefab(Registry& registry, Entity root);
+
+    // cree count copies et renvoie leurs racines
+    // place(i, transform) permet de positionner la racine de la copie i avant son ajout
+    std::vector<Entity> instantiate(Registry& registry, size_t count,
+                                    const std::function<void(size_t, Transform&)>& place = nullptr) const;
+
+    size_t size() const { return nodes.size(); }
+
+private:
+    struct Node {
+        int parent = -1; // index dans nodes, -1 pour la racine
+        std::vector<uint32_t> children; // index dans nodes
+        bool hasHierarchy = false;
+        bool interpolated = false; // PreviousTransform, recree vide : la copie n'a pas encore de pas precedent
+        std::optional<Transform> transform;
+        std::optional<MeshComponent> mesh;
+        std::optional<TextureComponent> texture;
+    };
+
+    std::vector<Node> nodes; // ordre prefixe : un parent est toujours avant ses enfants
+
+    void capture(Registry& registry, Entity entity, int parent);
+};
+
+/* exemple :
+    Prefab spherePrefab(registry, sphereEntity);
+
+    spherePrefab.instantiate(registry, 10000, [](size_t i, Transform& transform) {
+        transform.setPos({float(i % 100), 0, float(i / 100)});
+    });
+*/
+
+#endif // PREFAB_H
@@ -1,31 +1,64 @@
 #include "RenderSystem.hpp"
 #include "LuigiEngine/ECS.h"
 #include "LuigiEngine/SceneCamera.hpp"
+#include "LuigiEngine/Stats.hpp"
+#include "LuigiEngine/TransformMath.hpp"
+
+#include <algorithm>
+#include <cstring>
 
 using namespace glm;
 
-void RenderSystem::setupMeshRendering(const MeshComponent &meshComp, Transform &meshTransform, Transform &camTransform) {
+static const Stats::Id drawModelStat = Stats::getInstance().counter("matrices modele dessinees");
+static const Stats::Id drawCallStat = Stats::getInstance().counter("draw calls");
+static const Stats::Id frameDataStat = Stats::getInstance().counter("envois FrameData");
 
-  glUseProgram(meshComp.programID);
-  glUniformMatrix4fv(glGetUniformLocation(meshComp.programID, "mvp"), 1, GL_FALSE,
-                     &meshComp.mvp[0][0][0]);
+static const ShaderProgram::UniformId modelUniform = ShaderProgram::uniformId("model");
+static const ShaderProgram::UniformId rotationUniform = ShaderProgram::uniformId("rotation");
+static const ShaderProgram::UniformId cubeMapUniform = ShaderProgram::uniformId("cubeMap");
 
-  // PBR shader
-  if (!meshComp.material.empty()) {
-    vector<vec3> lights = {{0.0f, 0.0f, 0.0f}, {0.0f, 10.0f, 0.0f}, {0.0f, -10.0f, 0.0f}};
-    vector<vec3> lightColors = {{255.0f, 0.0f, 0.0f}, {0.0f, 255.0f, 0.0f}, {0.0f, 0.0f, 255.0f}};
-    vec3 cameraPos = vec3(camTransform.getGlobalModel()[3]);
+void RenderSystem::uploadFrameData(const CameraComponent &camera) {
+  if (!frameBuffer) {
+    glGenBuffers(1, &frameBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), nullptr, GL_DYNAMIC_DRAW);
+  }
+
+  FrameData data;
+  data.viewProj = camera.viewProj;
+  data.camPos = vec4(camera.position, 1.0f);
+  data.lightCount = int32_t(std::min(lights.size(), size_t(FrameData::MAX_LIGHTS)));
+  for (int i = 0; i < data.lightCount; i++) {
+    data.lightPositions[i] = vec4(lights[i].position, 1.0f);
+    data.lightColors[i] = vec4(lights[i].color, 0.0f);
+  }
+
+  // une seule copie par frame pour tous les dessins, aucune si camera et lumieres n'ont pas bouge
+  if (!frameDataSent || memcmp(&data, &frameData, sizeof(FrameData)) != 0) {
+    glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &data);
+    frameData = data;
+    frameDataSent = true;
+    Stats::getInstance().add(frameDataStat);
+  }
+  glBindBufferBase(GL_UNIFORM_BUFFER, ShaderProgram::FRAME_DATA_BINDING, frameBuffer);
+}
+
+void RenderSystem::setupMeshRendering(const MeshComponent &meshComp) {
+
+  // meshes tries par programme : use() ne rebinde qu'au changement, les uniforms inchanges ne sont pas renvoyes
+  ShaderProgram &program = *meshComp.program;
+  program.use();
+  program.set(modelUniform, meshComp.model); // viewProj est dans FrameData
 
-    mat3 globalRot = mat3(meshTransform.getGlobalModel());
+  // PBR shader (camera et lumieres sont dans FrameData)
+  if (!meshComp.material.empty()) {
+    mat3 globalRot = mat3(meshComp.model);
     globalRot[0] = normalize(globalRot[0]);
     globalRot[1] = normalize(globalRot[1]);
     globalRot[2] = normalize(globalRot[2]);
 
-    glUniformMatrix4fv(glGetUniformLocation(meshComp.programID, "model"), 1, GL_FALSE, &meshTransform.getGlobalModel()[0][0]);
-    glUniformMatrix3fv(glGetUniformLocation(meshComp.programID, "rotation"), 1, GL_FALSE, &globalRot[0][0]);
-    glUniform3fv(glGetUniformLocation(meshComp.programID, "lightPositions"), lights.size(), &lights[0][0]);
-    glUniform3fv(glGetUniformLocation(meshComp.programID, "lightColors"), lightColors.size(), &lightColors[0][0]);
-    glUniform3f(glGetUniformLocation(meshComp.programID, "camPos"), cameraPos[0], cameraPos[1], cameraPos[2]);
+    program.set(rotationUniform, globalRot);
   }
 
   glEnableVertexAttribArray(0);
@@ -46,12 +79,12 @@ void RenderSystem::bindTextureUniforms(const MeshComponent &meshComp,
   for (int i = 0; i < textures.textureIDs.size(); i++) {
     glActiveTexture(GL_TEXTURE0 + i);
     glBindTexture(GL_TEXTURE_2D, textures.textureIDs[i]);
-    glUniform1i(glGetUniformLocation(meshComp.programID, textures.texUniforms[i].c_str()), i);
+    meshComp.program->set(textures.uniformIds[i], GLint(i));
   }
   if (meshComp.cubeMapID != 0) {
     glActiveTexture(GL_TEXTURE31);
     glBindTexture(GL_TEXTURE_CUBE_MAP, meshComp.cubeMapID);
-    glUniform1i(glGetUniformLocation(meshComp.programID, "cubeMap"), 31);
+    meshComp.program->set(cubeMapUniform, GLint(31));
   }
 }
 
@@ -60,31 +93,78 @@ void RenderSystem::renderMesh(const MeshComponent &meshComp,
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshComp.elementbuffer);
   glDrawElements(GL_TRIANGLES, meshComp.activeMesh->triangles.size(),
                  GL_UNSIGNED_INT, nullptr);
+  Stats::getInstance().add(drawCallStat);
+}
+
+void RenderSystem::sortDrawOrder(Registry &registry) {
+  auto &meshes = registry.group<Transform>(with<MeshComponent>);
+  if (meshes.size() == sortedCount)
+    return;
+  sortedCount = meshes.size();
+
+  // meme programme, puis meme materiau, puis meme mesh a la suite : les changements d'etat OpenGL se regroupent
+  auto key = [&](Entity entity) {
+    const MeshComponent &meshComp = registry.get<MeshComponent>(entity);
+    return std::tuple<GLuint, const string &, Mesh *>(meshComp.program->getID(), meshComp.material,
+                                                     meshComp.meshes.empty() ? nullptr : meshComp.meshes[0].second);
+  };
+  meshes.sort([&](Entity a, Entity b) { return key(a) < key(b); });
+
+  // les MeshComponent dans l'ordre des Transform du groupe : le rendu parcourt les deux presque sequentiellement
+  registry.sortAs<MeshComponent, Transform>();
 }
 
 void RenderSystem::render(Registry &registry) {
 
+  // groupe possedant Transform, MeshComponent (Stable, il ne bouge pas) est lu via le sparse
+  // (recupere avant les references, sa creation reordonne le storage de Transform)
+  auto &meshes = registry.group<Transform>(with<MeshComponent>);
+
   CameraComponent &camera = registry.get<CameraComponent>(activeCamera);
   Transform &cameraTransform = registry.get<Transform>(activeCamera);
 
   vec3 cameraPos = cameraTransform.getPos();
 
-  for (auto entity : registry.view<MeshComponent, Transform>()) {
+  // seuls les meshes ajoutes ou deplaces depuis le dernier rendu sont recalcules, sauf si la camera a change (choix du LOD)
+  // ceux qui bougeaient au dernier pas de simulation suivent en plus l'interpolation entre deux pas (alpha)
+  uint32_t since = lastVersion;
+  bool cameraChanged = activeCamera != lastCamera || registry.changedSince<CameraComponent>(activeCamera, since);
+  bool alphaChanged = alpha != lastAlpha;
+  lastCamera = activeCamera;
+  lastAlpha = alpha;
+
+  // matrice modele dessinee et choix du LOD repartis sur les threads (aucun appel OpenGL ici)
+  if (cameraChanged || alphaChanged || registry.changedSince<Transform>(since) || registry.changedSince<MeshComponent>(since)) {
+    meshes.par_each([&](Entity entity, Transform &transform, MeshComponent &meshComp) {
+
+      const PreviousTransform *previous = registry.has<PreviousTransform>(entity) ? &registry.get<PreviousTransform>(entity) : nullptr;
+      const bool interpolated = previous && previous->moving;
+
+      if (cameraChanged || (interpolated && alphaChanged) || registry.changedSince<Transform>(entity, since) ||
+          registry.addedSince<MeshComponent>(entity, since)) {
+        meshComp.model = interpolated ? mat4(interpolateAffine(previous->model, transform.globalModel, alpha)) : transform.getGlobalModel();
+        vec3 entityPos = vec3(meshComp.model[3]);
+        meshComp.checkLOD(cameraPos, entityPos);
+        Stats::getInstance().add(drawModelStat); // bloc du thread courant, pas de contention
+      }
+    }, 64);
+  }
+  lastVersion = registry.advanceVersion();
 
-    // std::cout << "rendering entity " << entity << std::endl;
+  // le dessin reste sur le thread du contexte OpenGL
+  ShaderProgram::forgetCurrent(); // ImGui et le SceneRenderer ont change de programme depuis la frame precedente
+  uploadFrameData(camera);
+  meshes.each([&](Entity entity, Transform &transform, MeshComponent &meshComp) {
 
-    MeshComponent &meshComp = registry.get<MeshComponent>(entity);
-    Transform &transform = registry.get<Transform>(entity);
+    // std::cout << "rendering entity " << entity << std::endl;
 
-    vec3 entityPos = vec3(transform.getGlobalModel()[3]);
+    if (!meshComp.activeMesh) // composant sans mesh (liste de LOD vide) : rien a dessiner
+      return;
 
-    if (camera.viewProjChanged || transform.changed) {
-      meshComp.mvp = new mat4(camera.viewProj * transform.getGlobalModel());
-      transform.changed = false;
-      meshComp.checkLOD(cameraPos, entityPos);
-    }
+    if (meshComp.vboOutdated)
+      meshComp.useMeshBuffers();
 
-    setupMeshRendering(meshComp, transform, cameraTransform);
+    setupMeshRendering(meshComp);
 
     if (registry.has<TextureComponent>(entity)) {
       TextureComponent &textures = registry.get<TextureComponent>(entity);
@@ -99,5 +179,5 @@ void RenderSystem::render(Registry &registry) {
     glDisableVertexAttribArray(0);
     glDisableVertexAttribArray(2);
     glDisableVertexAttribArray(3);
-  }
+  });
 }
@@ -9,17 +9,58 @@
 
 #include "SceneMesh.hpp"
 #include "Transform.hpp"
+#include "SceneCamera.hpp"
 #include <GL/glew.h>
 #include <glm/gtc/matrix_transform.hpp>
 
+//donnees communes a tous les dessins d'une frame, envoyees une fois par frame dans un uniform buffer
+//disposition std140 du bloc FrameData des shaders (binding ShaderProgram::FRAME_DATA_BINDING) : les vec3 sont completes en vec4
+//viewProj est lue par les vertex shaders (gl_Position = viewProj * model * position), le reste par fragment_pbr
+struct FrameData {
+    static constexpr int MAX_LIGHTS = 4; //taille des tableaux du bloc dans les shaders
+
+    mat4 viewProj{1.0f};
+    vec4 camPos{0.0f};
+    vec4 lightPositions[MAX_LIGHTS]{};
+    vec4 lightColors[MAX_LIGHTS]{};
+    int32_t lightCount = 0;
+    int32_t padding[3]{}; //un bloc std140 est arrondi a 16 octets
+};
+static_assert(sizeof(FrameData) == 64 + 16 + 2 * 16 * FrameData::MAX_LIGHTS + 16, "FrameData ne suit plus la disposition std140");
+
+struct Light {
+    vec3 position;
+    vec3 color;
+};
+
 class RenderSystem {
 public:
     Entity activeCamera = INVALID;
+    float alpha = 1.0f; //position du rendu entre les deux derniers pas de simulation (FixedTimestep::getAlpha)
+
+    //lumieres de la scene, les FrameData::MAX_LIGHTS premieres sont envoyees aux shaders
+    std::vector<Light> lights = {{{0.0f, 0.0f, 0.0f}, {255.0f, 0.0f, 0.0f}},
+                                 {{0.0f, 10.0f, 0.0f}, {0.0f, 255.0f, 0.0f}},
+                                 {{0.0f, -10.0f, 0.0f}, {0.0f, 0.0f, 255.0f}}};
 
     void render(Registry& registry);
 
+    // range les meshes par programme / materiau / mesh quand leur nombre change
+    // (reordonne les storages : a appeler hors des systemes, avant le rendu)
+    void sortDrawOrder(Registry& registry);
+
 private:
-    void setupMeshRendering(const MeshComponent &meshComp, Transform &meshTransform, Transform &camTransform);
+    uint32_t lastVersion = 0; //version du registry au dernier rendu
+    Entity lastCamera = INVALID;
+    size_t sortedCount = 0; //nombre de meshes au dernier tri
+    float lastAlpha = 1.0f;
+
+    GLuint frameBuffer = 0; //uniform buffer de FrameData
+    FrameData frameData; //dernieres donnees envoyees
+    bool frameDataSent = false;
+
+    void uploadFrameData(const CameraComponent &camera);
+    void setupMeshRendering(const MeshComponent &meshComp);
     void bindTextureUniforms(const MeshComponent& meshComp, const TextureComponent& textures);
     void renderMesh(const MeshComponent& meshComp, const TextureComponent* textures);
 };
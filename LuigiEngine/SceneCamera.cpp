@@ -1,46 +1,40 @@
 #include "SceneCamera.hpp"
+#include "Stats.hpp"
+#include "TransformMath.hpp"
 
-extern int* nbViewProjUpdate;
 extern bool* optimizeMVP;
 
-void CameraSystem::update(Registry& registry) {
-    auto view = registry.view<CameraComponent, Transform>();
-
-    for (auto entity : view) {
-        auto& camera = registry.get<CameraComponent>(entity);
-        auto& transform = registry.get<Transform>(entity);
-
-        if (!camera.justDefinedMain)
-            camera.viewProjChanged = false;
-        else
-            camera.justDefinedMain = false;
-
-        if (!transform.upToDateGlobal)
-            camera.viewProjChanged = true;
-    }
-}
+static const Stats::Id viewProjStat = Stats::getInstance().counter("matrices view-projection");
 
 void CameraSystem::computeViewProj(Registry& registry) {
-    auto view = registry.view<CameraComponent, Transform>();
-
-    for (auto entity : view) {
-        auto& camera = registry.get<CameraComponent>(entity);
-        auto& transform = registry.get<Transform>(entity);
-
-        if (!*optimizeMVP || transform.changed) {
-            updateView(transform, camera);
-            camera.viewProj = camera.projection * camera.view;
-            camera.viewProjChanged = true;
-            transform.changed = false;
-            ++(*nbViewProjUpdate);
-        }
+    uint32_t since = lastVersion;
+    bool alphaChanged = alpha != lastAlpha;
+    lastAlpha = alpha;
+    auto & cameras = registry.group<CameraComponent>(with<Transform>);
+
+    if (!*optimizeMVP || alphaChanged || registry.changedSince<Transform>(since) || registry.changedSince<CameraComponent>(since)) {
+        cameras.each([&](Entity entity, CameraComponent& camera, Transform& transform) {
+            const PreviousTransform* previous = registry.has<PreviousTransform>(entity) ? &registry.get<PreviousTransform>(entity) : nullptr;
+            const bool interpolated = previous && previous->moving;
+
+            if (!*optimizeMVP || (interpolated && alphaChanged) || registry.changedSince<Transform>(entity, since) ||
+                registry.changedSince<CameraComponent>(entity, since)) {
+                updateView(interpolated ? glm::mat4(interpolateAffine(previous->model, transform.globalModel, alpha)) : transform.getGlobalModel(), camera);
+                camera.viewProj = camera.projection * camera.view;
+                registry.markChanged<CameraComponent>(entity);
+                Stats::getInstance().add(viewProjStat);
+            }
+        });
     }
+
+    lastVersion = registry.advanceVersion();
 }
 
-void CameraSystem::updateView( Transform& transform, CameraComponent& camera) {
-    glm::vec3 globalPos = glm::vec3(transform.getGlobalModel()[3]);
+void CameraSystem::updateView(const glm::mat4& model, CameraComponent& camera) {
+    glm::vec3 globalPos = glm::vec3(model[3]);
+    camera.position = globalPos;
 
-    glm::mat3 globalRot = glm::mat3(transform.getGlobalModel());
+    glm::mat3 globalRot = glm::mat3(model);
     globalRot[0] = glm::normalize(globalRot[0]);
     globalRot[1] = glm::normalize(globalRot[1]);
     globalRot[2] = glm::normalize(globalRot[2]);
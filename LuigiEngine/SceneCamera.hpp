@@ -10,28 +10,30 @@ struct CameraComponent {
     mat4 projection{1.0f};
     mat4 view{1.0f};
     mat4 viewProj{1.0f};
+    vec3 position{0.0f}; //position globale utilisee pour view (interpolee comme elle)
 
     vec3 target{0, 0, -1};
     vec3 up{0, 1, 0};
     vec3 right = normalize(cross(target, up));
 
-    bool viewProjChanged = true;
-    bool justDefinedMain = true;
     float speed = 1.0f;
 
     CameraComponent() = default;
     explicit CameraComponent(const mat4& proj) : projection(proj) {}
-
-    void onAttach(Registry & registry, Entity entity){};
-    void onDetach(Registry & registry, Entity entity){};
 };
 
 
+//recalcule viewProj des cameras dont la Transform a change, la camera est alors marquee modifiee
+//une camera avec un PreviousTransform qui bougeait au dernier pas est interpolee, et recalculee a chaque changement d'alpha
 class CameraSystem {
 public:
-    void update(Registry& registry);
+    float alpha = 1.0f; //position du rendu entre les deux derniers pas de simulation (FixedTimestep::getAlpha)
+
     void computeViewProj(Registry& registry);
 
 private:
-    static void updateView( Transform& transform, CameraComponent& camera);
+    uint32_t lastVersion = 0; //version du registry au dernier passage
+    float lastAlpha = 1.0f;
+
+    static void updateView(const glm::mat4& model, CameraComponent& camera);
 };
@@ -1,33 +1,21 @@
 #include "SceneMesh.hpp"
+#include "ThreadPool.hpp"
 
+#include <unordered_set>
 
-extern bool* optimizeMVP;
-
-
-
-void MeshComponent::createVBO() {
-    glGenBuffers(1, &vertexbuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-    glBufferData(GL_ARRAY_BUFFER, activeMesh->vertices.size() * sizeof(glm::vec3), &activeMesh->vertices[0], GL_STATIC_DRAW);
 
-    glGenBuffers(1, &normalbuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, normalbuffer);
-    glBufferData(GL_ARRAY_BUFFER, activeMesh->normals.size() * sizeof(glm::vec3), &activeMesh->normals[0], GL_STATIC_DRAW);
+extern bool* optimizeMVP;
 
-    glGenBuffers(1, &uvbuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, uvbuffer);
-    glBufferData(GL_ARRAY_BUFFER, activeMesh->uvs.size() * sizeof(glm::vec2), &activeMesh->uvs[0], GL_STATIC_DRAW);
 
-    glGenBuffers(1, &elementbuffer);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementbuffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, activeMesh->triangles.size() * sizeof(unsigned int), &activeMesh->triangles[0], GL_STATIC_DRAW);
-}
 
-void MeshComponent::clearVBO() {
-    glDeleteBuffers(1, &vertexbuffer);
-    glDeleteBuffers(1, &normalbuffer);
-    glDeleteBuffers(1, &uvbuffer);
-    glDeleteBuffers(1, &elementbuffer);
+void MeshComponent::useMeshBuffers() {
+    // les buffers appartiennent au Mesh : changer de LOD ne fait que changer de buffers, rien n'est cree par composant
+    const MeshBuffers& buffers = activeMesh->getBuffers();
+    vertexbuffer = buffers.vertex;
+    normalbuffer = buffers.normal;
+    uvbuffer = buffers.uv;
+    elementbuffer = buffers.element;
+    vboOutdated = false;
 }
 
 void MeshComponent::checkLOD(const glm::vec3& cameraPos, const glm::vec3& entityPos) {
@@ -39,43 +27,79 @@ void MeshComponent::checkLOD(const glm::vec3& cameraPos, const glm::vec3& entity
         if (distanceToCamera >= meshes[i].first) {
             if (activeMesh != meshes[i].second) {
                 activeMesh = meshes[i].second;
-                createVBO();
+                vboOutdated = true;
             }
             break;
         }
     }
 }
 
-void MeshComponent::onAttach(Registry& registry, Entity entity){
-	if (!texFiles.empty() && !texUniforms.empty()) {
-
-		if(!registry.has<TextureComponent>(entity)){
-			auto& textureComponent = registry.emplace<TextureComponent>(entity, texFiles, texUniforms);
-			textureComponent.loadTextures();
-		}
-
-	}
-};
-
-void TextureComponent::loadTextures() {
-    textureIDs.resize(texFiles.size());
-    for (int i = 0; i < texFiles.size(); i++) {
-        int width, height, nrChannels;
-        unsigned char* img = stbi_load(("textures/" + texFiles[i]).c_str(), &width, &height, &nrChannels, 0);
-        glGenTextures(1, &textureIDs[i]);
-        glBindTexture(GL_TEXTURE_2D, textureIDs[i]);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        GLint type = GL_RGB;
-        if (nrChannels == 4) type = GL_RGBA;
-        else if (nrChannels == 2) type = GL_RG;
-        else if (nrChannels == 1) type = GL_R;
-
-        glTexImage2D(GL_TEXTURE_2D, 0, type, width, height, 0, type, GL_UNSIGNED_BYTE, img);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        stbi_image_free(img);
+TextureSystem::TextureSystem(Registry& registry)
+    : newMeshes(registry.observe<MeshComponent>(ObserverEvent::Construct)),
+      newTextures(registry.observe<TextureComponent>(ObserverEvent::Construct)) {}
+
+void TextureSystem::update(Registry& registry) {
+    // les meshes qui ont des textures recoivent leur TextureComponent, rempli plus bas dans le meme passage
+    newMeshes.each([&](Entity entity) {
+        MeshComponent& mesh = registry.get<MeshComponent>(entity);
+        if (!mesh.texFiles.empty() && !mesh.texUniforms.empty() && !registry.has<TextureComponent>(entity))
+            registry.emplace<TextureComponent>(entity, mesh.texFiles, mesh.texUniforms);
+    });
+
+    vector<Entity> entities = newTextures.take();
+    if (entities.empty()) return;
+
+    // fichiers pas encore charges, chacun une seule fois
+    vector<string> files;
+    unordered_set<string> seen;
+    for (Entity entity : entities) {
+        const TextureComponent& textures = registry.get<TextureComponent>(entity);
+        if (!textures.textureIDs.empty()) continue; // deja rempli (copie d'un prefab)
+        for (const string& file : textures.texFiles)
+            if (!cache.count(file) && seen.insert(file).second) files.push_back(file);
+    }
+
+    // decodage en parallele, stb_image ne touche pas a OpenGL
+    struct Image {
+        unsigned char* data = nullptr;
+        int width = 0, height = 0, nrChannels = 0;
+    };
+    vector<Image> images(files.size());
+    ThreadPool::getInstance().parallelFor(files.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            images[i].data = stbi_load(("textures/" + files[i]).c_str(), &images[i].width, &images[i].height, &images[i].nrChannels, 0);
+    });
+
+    // envoi a OpenGL sur le thread du contexte
+    for (size_t i = 0; i < files.size(); i++) {
+        if (!images[i].data) cout << "Texture failed to load at path: " << files[i] << endl;
+        cache[files[i]] = upload(images[i].data, images[i].width, images[i].height, images[i].nrChannels);
+        stbi_image_free(images[i].data);
     }
+
+    for (Entity entity : entities) {
+        TextureComponent& textures = registry.get<TextureComponent>(entity);
+        if (!textures.textureIDs.empty()) continue;
+        for (const string& file : textures.texFiles)
+            textures.textureIDs.push_back(cache[file]);
+    }
+}
+
+GLuint TextureSystem::upload(unsigned char* data, int width, int height, int nrChannels) {
+    GLuint textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    GLint type = GL_RGB;
+    if (nrChannels == 4) type = GL_RGBA;
+    else if (nrChannels == 2) type = GL_RG;
+    else if (nrChannels == 1) type = GL_R;
+
+    glTexImage2D(GL_TEXTURE_2D, 0, type, width, height, 0, type, GL_UNSIGNED_BYTE, data);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return textureID;
 }
 
 GLuint MeshComponent::loadCubemap(string folder)
@@ -6,8 +6,10 @@
 #include <glm/glm.hpp>
 #include <GL/glew.h>
 #include "Mesh.hpp"
+#include "ShaderProgram.hpp"
 
 #include <string>
+#include <unordered_map>
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <GL/glew.h>
@@ -20,17 +22,19 @@ using namespace std;
 
 struct MeshComponent {
     vector<pair<double, Mesh*>> meshes;
-    Mesh* activeMesh;
+    Mesh* activeMesh = nullptr;
 
-    GLuint vertexbuffer;
-    GLuint normalbuffer;
-    GLuint uvbuffer;
-    GLuint elementbuffer;
+    // buffers du Mesh actif (MeshBuffers), partages avec les autres composants qui l'affichent
+    GLuint vertexbuffer = 0;
+    GLuint normalbuffer = 0;
+    GLuint uvbuffer = 0;
+    GLuint elementbuffer = 0;
 	vector<string> texFiles;
     vector<string> texUniforms;
 
-    GLuint programID;
-    mat4* mvp;
+    ShaderProgram* program = nullptr; // partage entre les meshes, jamais detruit par eux
+    mat4 model{1.0f}; // matrice modele dessinee, interpolee entre les deux derniers pas de simulation
+    bool vboOutdated = false; // le LOD actif a change, les buffers du nouveau Mesh sont repris sur le thread OpenGL
     string material = "";
 	GLuint cubeMapID = 0;
 
@@ -38,14 +42,14 @@ struct MeshComponent {
 
 	MeshComponent(
         const vector<pair<double, Mesh*>>& meshes,
-        GLuint programID,
+        ShaderProgram* program,
         const vector<string>& texFiles_in = {},
         const vector<string>& texUniforms_in = {},
         const string& material = "",
         const string& cubeMap = ""
-    ) : meshes(meshes), activeMesh(meshes.empty() ? nullptr : meshes[0].second), programID(programID), mvp(nullptr) {
+    ) : meshes(meshes), activeMesh(meshes.empty() ? nullptr : meshes[0].second), program(program) {
 
-			createVBO();
+			if (activeMesh) useMeshBuffers();
 			if (material.empty()) {
 				texFiles = texFiles_in;
 				texUniforms = texUniforms_in;
@@ -60,19 +64,20 @@ struct MeshComponent {
     }
 
 
-    void createVBO();
-    void clearVBO();
-    void checkLOD(const vec3& cameraPos, const vec3& entityPos);
+    void useMeshBuffers(); // thread OpenGL, activeMesh non nul
+    void checkLOD(const vec3& cameraPos, const vec3& entityPos); // sans appel OpenGL, peut tourner en parallele
 	static GLuint loadCubemap(string folder);
-
-	void onAttach(Registry& registry, Entity entity);
-    void onDetach(Registry& registry, Entity entity){};
 };
 
+// gros composant (vecteurs, chaines) : supprime sur place sans copie, les pointeurs restent valides entre les frames
+template<> struct StoragePolicy<MeshComponent> { static constexpr StorageMode mode = StorageMode::Stable; };
+
 
+// textureIDs est rempli par le TextureSystem
 struct TextureComponent {
     vector<string> texFiles;
     vector<string> texUniforms;
+    vector<ShaderProgram::UniformId> uniformIds; // ids de texUniforms, pour les setters du ShaderProgram
     vector<GLuint> textureIDs;
 
 	TextureComponent(
@@ -80,13 +85,27 @@ struct TextureComponent {
         const vector<string>& texUniforms = {}
     )
         : texFiles(texFiles), texUniforms(texUniforms) {
-        loadTextures();
+        for (const string& uniform : texUniforms) uniformIds.push_back(ShaderProgram::uniformId(uniform));
     }
+};
+
+
+// Charge en un seul lot les textures des composants ajoutes depuis le dernier passage :
+// un MeshComponent avec des texFiles recoit son TextureComponent, chaque fichier n'est decode qu'une fois (cache),
+// les decodages tournent en parallele et l'envoi a OpenGL reste sur le thread appelant.
+// A creer avant d'ajouter les meshes, update() hors des systemes paralleles (il ajoute des composants)
+class TextureSystem {
+public:
+    explicit TextureSystem(Registry& registry);
+
+    void update(Registry& registry);
 
-    void loadTextures();
+private:
+    Observer& newMeshes;
+    Observer& newTextures;
+    unordered_map<string, GLuint> cache; // fichier -> texture OpenGL
 
-	void onAttach(Registry& registry, Entity entity){};
-    void onDetach(Registry& registry, Entity entity){};
+    static GLuint upload(unsigned char* data, int width, int height, int nrChannels);
 };
 
 
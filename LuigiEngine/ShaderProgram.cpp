@@ -0,0 +1,213 @@
+#include "ShaderProgram.hpp"
+#include "Stats.hpp"
+
+#include <common/shader.hpp>
+
+#include <cassert>
+#include <cstring>
+#include <mutex>
+
+using namespace glm;
+using namespace std;
+
+// un setter appele = un glGetUniformLocation evite, plus le glUniform* quand la valeur n'a pas change
+static const Stats::Id uploadStat = Stats::getInstance().counter("uniforms envoyes");
+static const Stats::Id savedStat = Stats::getInstance().counter("appels GL evites (uniforms)");
+
+// programme actif d'apres ShaderProgram::use, 0 au demarrage ou apres un glUseProgram fait ailleurs
+static GLuint currentProgram = 0;
+
+namespace {
+    struct UniformNames {
+        mutex lock;
+        unordered_map<string, ShaderProgram::UniformId> ids;
+        vector<string> names;
+    };
+
+    UniformNames& uniformNames() {
+        static UniformNames instance; // cree au premier appel : utilisable depuis les constantes statiques des autres fichiers
+        return instance;
+    }
+
+    // taille d'un element de chaque type, telle que glUniform* la lit
+    size_t typeSize(GLenum type) {
+        switch (type) {
+            case GL_FLOAT: case GL_INT: case GL_UNSIGNED_INT: case GL_BOOL: return 4;
+            case GL_FLOAT_VEC2: case GL_INT_VEC2: case GL_BOOL_VEC2: return 8;
+            case GL_FLOAT_VEC3: case GL_INT_VEC3: case GL_BOOL_VEC3: return 12;
+            case GL_FLOAT_VEC4: case GL_INT_VEC4: case GL_BOOL_VEC4: case GL_FLOAT_MAT2: return 16;
+            case GL_FLOAT_MAT3: return 36;
+            case GL_FLOAT_MAT4: return 64;
+            case GL_FLOAT_MAT2x3: case GL_FLOAT_MAT3x2: return 24;
+            case GL_FLOAT_MAT2x4: case GL_FLOAT_MAT4x2: return 32;
+            case GL_FLOAT_MAT3x4: case GL_FLOAT_MAT4x3: return 48;
+            default: return 4; // samplers
+        }
+    }
+
+    string baseName(const char* name) {
+        string result = name;
+        size_t bracket = result.find('[');
+        if (bracket != string::npos) result.resize(bracket);
+        return result;
+    }
+}
+
+ShaderProgram::UniformId ShaderProgram::uniformId(const string& name) {
+    UniformNames& table = uniformNames();
+    lock_guard<mutex> guard(table.lock);
+    auto [it, inserted] = table.ids.emplace(name, UniformId(table.names.size()));
+    if (inserted) table.names.push_back(name);
+    return it->second;
+}
+
+ShaderProgram::ShaderProgram(const char* vertexPath, const char* fragmentPath) {
+    programID = LoadShaders(vertexPath, fragmentPath);
+    if (programID) reflect();
+}
+
+ShaderProgram::~ShaderProgram() {
+    if (currentProgram == programID) currentProgram = 0;
+    if (programID) glDeleteProgram(programID);
+}
+
+void ShaderProgram::reflect() {
+    GLint count = 0, maxLength = 0;
+
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    vector<char> name(max(maxLength, 1));
+    uniforms.resize(count);
+    for (GLint i = 0; i < count; i++) {
+        Uniform& uniform = uniforms[i];
+        glGetActiveUniform(programID, GLuint(i), GLsizei(name.size()), nullptr, &uniform.size, &uniform.type, name.data());
+        uniform.name = baseName(name.data());
+        uniform.location = glGetUniformLocation(programID, name.data());
+
+        const GLuint index = GLuint(i);
+        glGetActiveUniformsiv(programID, 1, &index, GL_UNIFORM_BLOCK_INDEX, &uniform.block);
+        glGetActiveUniformsiv(programID, 1, &index, GL_UNIFORM_OFFSET, &uniform.blockOffset);
+
+        // les uniforms de bloc sont remplis par leur buffer, pas par les setters : pas de cache
+        if (uniform.location >= 0) {
+            uniform.cacheOffset = cache.size();
+            uniform.cacheSize = typeSize(uniform.type) * uniform.size;
+            cache.resize(cache.size() + uniform.cacheSize);
+        }
+        uniformIndex.emplace(uniform.name, uint32_t(i));
+    }
+
+    glGetProgramiv(programID, GL_ACTIVE_ATTRIBUTES, &count);
+    glGetProgramiv(programID, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+    name.resize(max(maxLength, 1));
+    attributes.resize(count);
+    for (GLint i = 0; i < count; i++) {
+        Attribute& attribute = attributes[i];
+        glGetActiveAttrib(programID, GLuint(i), GLsizei(name.size()), nullptr, &attribute.size, &attribute.type, name.data());
+        attribute.name = baseName(name.data());
+        attribute.location = glGetAttribLocation(programID, name.data());
+    }
+
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+    name.resize(max(maxLength, 1));
+    blocks.resize(count);
+    for (GLint i = 0; i < count; i++) {
+        UniformBlock& block = blocks[i];
+        glGetActiveUniformBlockName(programID, GLuint(i), GLsizei(name.size()), nullptr, name.data());
+        block.name = name.data();
+        block.index = GLuint(i);
+        glGetActiveUniformBlockiv(programID, GLuint(i), GL_UNIFORM_BLOCK_DATA_SIZE, &block.dataSize);
+
+        // #version 330 n'a pas layout(binding = ...) : le point de binding est donne ici
+        if (block.name == "FrameData") {
+            block.binding = GLint(FRAME_DATA_BINDING);
+            glUniformBlockBinding(programID, block.index, FRAME_DATA_BINDING);
+        }
+    }
+}
+
+void ShaderProgram::use() const {
+    if (currentProgram == programID) {
+        Stats::getInstance().add(savedStat);
+        return;
+    }
+    glUseProgram(programID);
+    currentProgram = programID;
+}
+
+void ShaderProgram::forgetCurrent() {
+    currentProgram = 0;
+}
+
+ShaderProgram::Uniform* ShaderProgram::find(UniformId id) {
+    if (id >= slots.size()) slots.resize(id + 1, UNRESOLVED);
+    if (slots[id] == UNRESOLVED) {
+        UniformNames& table = uniformNames();
+        lock_guard<mutex> guard(table.lock);
+        auto it = uniformIndex.find(table.names[id]);
+        // absent (ou elimine par le compilateur GLSL) / dans un bloc : rien a envoyer
+        slots[id] = it == uniformIndex.end() || uniforms[it->second].location < 0 ? -1 : int32_t(it->second);
+    }
+    return slots[id] < 0 ? nullptr : &uniforms[slots[id]];
+}
+
+bool ShaderProgram::changed(Uniform* uniform, const void* value, size_t size) {
+    assert(currentProgram == programID && "uniform envoye a un programme qui n'est pas actif");
+    // uniform absent du programme ou valeur deja envoyee : ni glGetUniformLocation ni glUniform*
+    if (!uniform || (uniform->known && memcmp(cache.data() + uniform->cacheOffset, value, size) == 0)) {
+        Stats::getInstance().add(savedStat, 2);
+        return false;
+    }
+    assert(size <= uniform->cacheSize && "valeur plus grande que l'uniform");
+    memcpy(cache.data() + uniform->cacheOffset, value, size);
+    uniform->known = size == uniform->cacheSize; // un tableau envoye en partie n'est pas entierement connu
+    Stats::getInstance().add(uploadStat);
+    Stats::getInstance().add(savedStat); // glGetUniformLocation
+    return true;
+}
+
+void ShaderProgram::set(UniformId id, GLint value) {
+    Uniform* uniform = find(id);
+    if (changed(uniform, &value, sizeof(value))) glUniform1i(uniform->location, value);
+}
+
+void ShaderProgram::set(UniformId id, float value) {
+    Uniform* uniform = find(id);
+    if (changed(uniform, &value, sizeof(value))) glUniform1f(uniform->location, value);
+}
+
+void ShaderProgram::set(UniformId id, const vec3& value) {
+    Uniform* uniform = find(id);
+    if (changed(uniform, &value[0], sizeof(float) * 3)) glUniform3fv(uniform->location, 1, &value[0]);
+}
+
+void ShaderProgram::set(UniformId id, const vec3* values, GLsizei count) {
+    Uniform* uniform = find(id);
+    if (uniform) count = min(count, uniform->size);
+    if (changed(uniform, &values[0][0], sizeof(float) * 3 * count)) glUniform3fv(uniform->location, count, &values[0][0]);
+}
+
+void ShaderProgram::set(UniformId id, const mat3& value) {
+    Uniform* uniform = find(id);
+    if (changed(uniform, &value[0][0], sizeof(float) * 9)) glUniformMatrix3fv(uniform->location, 1, GL_FALSE, &value[0][0]);
+}
+
+void ShaderProgram::set(UniformId id, const mat4& value) {
+    Uniform* uniform = find(id);
+    if (changed(uniform, &value[0][0], sizeof(float) * 16)) glUniformMatrix4fv(uniform->location, 1, GL_FALSE, &value[0][0]);
+}
+
+GLint ShaderProgram::attributeLocation(const string& name) const {
+    for (const Attribute& attribute : attributes) {
+        if (attribute.name == name) return attribute.location;
+    }
+    return -1;
+}
+
+const ShaderProgram::UniformBlock* ShaderProgram::uniformBlock(const string& name) const {
+    for (const UniformBlock& block : blocks) {
+        if (block.name == name) return &block;
+    }
+    return nullptr;
+}
@@ -0,0 +1,106 @@
+#ifndef SHADERPROGRAM_HPP
+#define SHADERPROGRAM_HPP
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Programme OpenGL compile par LoadShaders, avec ses uniforms, attributs et blocs d'uniforms lus une fois au link.
+// Les uniforms sont designes par un UniformId, enregistre une fois par nom et commun a tous les programmes :
+// plus de glGetUniformLocation au dessin. Chaque programme garde la derniere valeur envoyee de chaque uniform
+// et n'appelle glUniform* que si elle a change ; use() ne rebinde pas le programme deja actif.
+// Les setters s'appliquent au programme actif (use() avant) et sont appeles depuis le thread OpenGL.
+class ShaderProgram {
+public:
+    using UniformId = uint32_t;
+
+    // blocs d'uniforms partages : meme point de binding dans tous les programmes qui les declarent
+    static constexpr GLuint FRAME_DATA_BINDING = 0; // bloc FrameData (camera, lumieres), voir RenderSystem::FrameData
+
+    struct Uniform {
+        std::string name; // sans le [0] des tableaux
+        GLint location = -1; // -1 pour un uniform de bloc
+        GLenum type = 0;
+        GLint size = 0; // nombre d'elements d'un tableau, 1 sinon
+        GLint block = -1; // index du bloc d'uniforms qui le contient
+        GLint blockOffset = -1; // position dans le bloc, en octets
+        size_t cacheOffset = 0; // derniere valeur envoyee, dans cache
+        size_t cacheSize = 0;
+        bool known = false; // faux tant qu'aucune valeur n'a ete envoyee
+    };
+
+    struct Attribute {
+        std::string name;
+        GLint location = -1;
+        GLenum type = 0;
+        GLint size = 0;
+    };
+
+    struct UniformBlock {
+        std::string name;
+        GLuint index = GL_INVALID_INDEX;
+        GLint dataSize = 0; // en octets, disposition std140 comprise
+        GLint binding = -1; // point de binding donne au link, -1 si le bloc n'est pas un bloc partage connu
+    };
+
+    // enregistre un nom d'uniform, ou renvoie l'id qu'il a deja : a garder dans une constante statique
+    static UniformId uniformId(const std::string& name);
+
+    ShaderProgram(const char* vertexPath, const char* fragmentPath);
+    ~ShaderProgram();
+
+    ShaderProgram(const ShaderProgram&) = delete;
+    ShaderProgram& operator=(const ShaderProgram&) = delete;
+
+    GLuint getID() const { return programID; }
+
+    void use() const;
+
+    // a appeler quand du code hors ShaderProgram (ImGui, SceneRenderer...) a pu changer le programme actif
+    static void forgetCurrent();
+
+    bool has(UniformId id) { return find(id) != nullptr; }
+
+    void set(UniformId id, GLint value);
+    void set(UniformId id, float value);
+    void set(UniformId id, const glm::vec3& value);
+    void set(UniformId id, const glm::vec3* values, GLsizei count);
+    void set(UniformId id, const glm::mat3& value);
+    void set(UniformId id, const glm::mat4& value);
+
+    const std::vector<Uniform>& getUniforms() const { return uniforms; }
+    const std::vector<Attribute>& getAttributes() const { return attributes; }
+    const std::vector<UniformBlock>& getUniformBlocks() const { return blocks; }
+
+    GLint attributeLocation(const std::string& name) const; // -1 si absent
+    const UniformBlock* uniformBlock(const std::string& name) const; // nullptr si absent
+
+private:
+    static constexpr int32_t UNRESOLVED = -2; // id pas encore cherche dans ce programme (-1 : absent)
+
+    GLuint programID = 0;
+    std::vector<Uniform> uniforms;
+    std::vector<Attribute> attributes;
+    std::vector<UniformBlock> blocks;
+    std::unordered_map<std::string, uint32_t> uniformIndex; // nom -> index dans uniforms
+    std::vector<int32_t> slots; // UniformId -> index dans uniforms, rempli a la premiere utilisation de l'id
+    std::vector<uint8_t> cache; // dernieres valeurs envoyees
+
+    void reflect();
+    Uniform* find(UniformId id);
+    bool changed(Uniform* uniform, const void* value, size_t size); // et garde la nouvelle valeur, faux pour un uniform absent
+};
+
+/* exemple :
+    static const ShaderProgram::UniformId modelUniform = ShaderProgram::uniformId("model");
+
+    ShaderProgram program("shaders/vertex.glsl", "shaders/fragment.glsl");
+    program.use();
+    program.set(modelUniform, model);
+*/
+
+#endif // SHADERPROGRAM_HPP
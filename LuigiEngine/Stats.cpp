@@ -0,0 +1,83 @@
+#include "Stats.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+
+using namespace std;
+
+double Stats::Series::average() const {
+    if (frames == 0) return 0;
+    double sum = 0;
+    for (size_t i = 0; i < frames; i++) sum += history[i];
+    return sum / frames;
+}
+
+double Stats::Series::max() const {
+    if (frames == 0) return 0;
+    return *max_element(history.begin(), history.begin() + frames);
+}
+
+Stats& Stats::getInstance() {
+    static Stats instance;
+    return instance;
+}
+
+Stats::Id Stats::counter(const string& name) {
+    return registerSeries(name, false);
+}
+
+Stats::Id Stats::timer(const string& name) {
+    return registerSeries(name, true);
+}
+
+Stats::Id Stats::registerSeries(const string& name, bool isTimer) {
+    lock_guard<mutex> guard(lock);
+    for (Id id = 0; id < series.size(); id++) {
+        if (series[id].name == name) return id;
+    }
+    assert(series.size() < MAX_STATS && "trop de statistiques, augmenter Stats::MAX_STATS");
+    series.emplace_back();
+    series.back().name = name;
+    series.back().isTimer = isTimer;
+    return Id(series.size() - 1);
+}
+
+Stats::ThreadSlots& Stats::localSlots() {
+    // un bloc par thread, cree a sa premiere statistique et garde jusqu'a la fin du programme
+    static thread_local ThreadSlots* slots = nullptr;
+    if (!slots) {
+        lock_guard<mutex> guard(lock);
+        threads.push_back(make_unique<ThreadSlots>());
+        slots = threads.back().get();
+    }
+    return *slots;
+}
+
+void Stats::endFrame() {
+    lock_guard<mutex> guard(lock);
+    for (Id id = 0; id < series.size(); id++) {
+        int64_t total = 0;
+        for (auto& thread : threads) {
+            total += thread->values[id].load(memory_order_relaxed);
+            thread->values[id].store(0, memory_order_relaxed);
+        }
+
+        Series& stat = series[id];
+        stat.last = stat.isTimer ? total / 1e6 : double(total);
+        stat.history[stat.head] = float(stat.last);
+        stat.head = (stat.head + 1) % HISTORY_SIZE;
+        stat.frames = std::min(stat.frames + 1, HISTORY_SIZE);
+    }
+}
+
+void Stats::dump(ostream& out) const {
+    char line[160];
+    snprintf(line, sizeof(line), "%-32s %12s %12s %12s\n", "", "frame", "moyenne", "max");
+    out << line;
+    for (const Series& stat : series) {
+        const char* unit = stat.isTimer ? " ms" : "";
+        snprintf(line, sizeof(line), "%-32s %12.3f %12.3f %12.3f%s\n", stat.name.c_str(), stat.last, stat.average(), stat.max(), unit);
+        out << line;
+    }
+}
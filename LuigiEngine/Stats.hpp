@@ -0,0 +1,98 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Statistiques de la frame : compteurs et chronos nommes, enregistres une fois au demarrage.
+// add() / addTime() ecrivent dans un bloc propre au thread appelant (ni verrou ni operation atomique partagee),
+// endFrame() additionne les blocs de tous les threads, garde le total de la frame et l'ajoute a l'historique.
+// endFrame() est appele hors de tout travail parallele (apres scheduler.run()).
+class Stats {
+public:
+    using Id = uint32_t;
+
+    static constexpr size_t MAX_STATS = 64;
+    static constexpr size_t HISTORY_SIZE = 240; // frames gardees pour les moyennes et les courbes
+
+    struct Series {
+        std::string name;
+        bool isTimer = false; // valeurs en millisecondes
+        double last = 0; // total de la derniere frame terminee
+        std::array<float, HISTORY_SIZE> history{};
+        size_t head = 0; // prochaine case ecrite dans history, la plus ancienne valeur
+        size_t frames = 0; // nombre de cases remplies
+
+        double average() const;
+        double max() const;
+    };
+
+    static Stats& getInstance();
+
+    Stats(const Stats&) = delete;
+    Stats& operator=(const Stats&) = delete;
+
+    // enregistre un compteur / chrono, ou renvoie celui qui porte deja ce nom
+    Id counter(const std::string& name);
+    Id timer(const std::string& name);
+
+    inline void add(Id id, int64_t value = 1) {
+        std::atomic<int64_t>& slot = localSlots().values[id];
+        slot.store(slot.load(std::memory_order_relaxed) + value, std::memory_order_relaxed); // seul ce thread ecrit
+    }
+
+    inline void addTime(Id id, std::chrono::steady_clock::duration duration) {
+        add(id, std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+    }
+
+    // mesure la duree de sa portee : { Stats::ScopedTimer timer(renderTimer); ... }
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(Id id) : id(id), start(std::chrono::steady_clock::now()) {}
+        ~ScopedTimer() { Stats::getInstance().addTime(id, std::chrono::steady_clock::now() - start); }
+
+    private:
+        Id id;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    // additionne les threads et passe a la frame suivante
+    void endFrame();
+
+    const std::vector<Series>& getSeries() const { return series; }
+    const Series& get(Id id) const { return series[id]; }
+
+    // derniere frame, moyenne et maximum sur l'historique
+    void dump(std::ostream& out) const;
+
+private:
+    struct ThreadSlots {
+        std::array<std::atomic<int64_t>, MAX_STATS> values{};
+    };
+
+    Stats() = default;
+
+    Id registerSeries(const std::string& name, bool isTimer);
+    ThreadSlots& localSlots();
+
+    std::mutex lock; // enregistrement des stats et des threads
+    std::vector<Series> series;
+    std::vector<std::unique_ptr<ThreadSlots>> threads;
+};
+
+/* exemple :
+    static const Stats::Id drawCalls = Stats::getInstance().counter("draw calls");
+    static const Stats::Id renderTime = Stats::getInstance().timer("rendu");
+
+    { Stats::ScopedTimer timer(renderTime); ... Stats::getInstance().add(drawCalls); ... }
+    Stats::getInstance().endFrame(); // une fois par frame
+*/
+
+#endif // STATS_HPP
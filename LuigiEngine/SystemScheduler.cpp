@@ -0,0 +1,84 @@
+#include "SystemScheduler.hpp"
+
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+bool SystemScheduler::conflicts(const SystemAccess& a, const SystemAccess& b) {
+    for (uint32_t type : a.writes)
+        if (b.canRead(type)) return true; // b lit ou ecrit ce que a ecrit
+    for (uint32_t type : b.writes)
+        if (a.canRead(type)) return true;
+    return false;
+}
+
+void SystemScheduler::addSystem(unique_ptr<System> system) {
+    sort(system->access.reads.begin(), system->access.reads.end());
+    sort(system->access.writes.begin(), system->access.writes.end());
+
+    // l'ordre d'ajout decide entre deux systemes en conflit
+    size_t index = systems.size();
+    for (size_t previous = 0; previous < index; previous++) {
+        if (conflicts(systems[previous]->access, system->access)) {
+            systems[previous]->dependents.push_back(index);
+            system->dependencyCount++;
+        }
+    }
+    systems.push_back(std::move(system));
+}
+
+void SystemScheduler::schedule(size_t index) {
+    if (systems[index]->mainThread) {
+        lock_guard<mutex> guard(mainLock);
+        mainReady.push_back(index);
+    } else {
+        ThreadPool::getInstance().submit([this, index]() { execute(index); }, pending);
+    }
+}
+
+void SystemScheduler::execute(size_t index) {
+    System& system = *systems[index];
+
+    // un thread qui attend dans un par_each peut executer un autre systeme : on restaure l'acces precedent
+    const SystemAccess* previous = currentSystemAccess();
+    currentSystemAccess() = &system.access;
+    {
+        Stats::ScopedTimer timer(system.timer);
+        system.func(registry);
+    }
+    currentSystemAccess() = previous;
+
+    for (size_t dependent : system.dependents) {
+        if (--systems[dependent]->remaining == 0) schedule(dependent);
+    }
+    finished++;
+}
+
+void SystemScheduler::run() {
+    ThreadPool& pool = ThreadPool::getInstance();
+
+    finished = 0;
+    for (auto& system : systems) system->remaining = system->dependencyCount;
+    for (size_t i = 0; i < systems.size(); i++) {
+        if (systems[i]->dependencyCount == 0) schedule(i);
+    }
+
+    // le thread appelant execute les systemes mainThread et aide le pool en attendant
+    while (finished < systems.size()) {
+        size_t next = systems.size();
+        {
+            lock_guard<mutex> guard(mainLock);
+            if (!mainReady.empty()) {
+                next = mainReady.back();
+                mainReady.pop_back();
+            }
+        }
+
+        if (next != systems.size()) execute(next);
+        else if (!pool.tryRunOne()) this_thread::yield();
+    }
+    pool.wait(pending);
+
+    commandBuffer.flush();
+}
@@ -0,0 +1,95 @@
+#ifndef SYSTEMSCHEDULER_HPP
+#define SYSTEMSCHEDULER_HPP
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ECS.h"
+#include "Stats.hpp"
+#include "ThreadPool.hpp"
+
+// composants lus / ecrits par un systeme : scheduler.add("camera", Reads<Transform>{}, Writes<CameraComponent>{}, ...)
+template<typename... Components>
+struct Reads {};
+
+template<typename... Components>
+struct Writes {};
+
+// Lance les systemes d'une frame sur le ThreadPool.
+// Deux systemes sont en conflit si l'un ecrit un composant que l'autre lit ou ecrit : le premier ajoute passe alors avant.
+// Les systemes sans conflit tournent en meme temps. En debug, un acces non declare fait echouer un assert.
+// Un systeme ne change pas la structure du registry directement, il passe par commands() applique a la fin de run().
+// Le temps de chaque systeme est mesure dans les Stats ("systeme <nom>").
+class SystemScheduler {
+public:
+    explicit SystemScheduler(Registry& registry) : registry(registry), commandBuffer(registry) {}
+
+    SystemScheduler(const SystemScheduler&) = delete;
+    SystemScheduler& operator=(const SystemScheduler&) = delete;
+
+    // mainThread : le systeme tourne sur le thread qui appelle run() (OpenGL)
+    template<typename... Read, typename... Write>
+    void add(const std::string& name, Reads<Read...>, Writes<Write...>, std::function<void(Registry&)> func, bool mainThread = false) {
+        // les storages sont crees ici : les systemes paralleles ne font ensuite que les lire
+        (registry.assure<Read>(), ...);
+        (registry.assure<Write>(), ...);
+
+        auto system = std::make_unique<System>();
+        system->access.name = name;
+        system->access.reads = {componentTypeID<Read>()...};
+        system->access.writes = {componentTypeID<Write>()...};
+        system->func = std::move(func);
+        system->mainThread = mainThread;
+        system->timer = Stats::getInstance().timer("systeme " + name);
+        addSystem(std::move(system));
+    }
+
+    // lance tous les systemes et attend qu'ils soient finis, puis applique les commandes
+    void run();
+
+    CommandBuffer& commands() { return commandBuffer; }
+
+    size_t size() const { return systems.size(); }
+
+private:
+    struct System {
+        SystemAccess access;
+        std::function<void(Registry&)> func;
+        bool mainThread = false;
+        Stats::Id timer = 0;
+        std::vector<size_t> dependents; // systemes ajoutes apres et en conflit avec celui-ci
+        size_t dependencyCount = 0;
+        std::atomic<size_t> remaining{0}; // dependances pas encore finies pendant run()
+    };
+
+    Registry& registry;
+    CommandBuffer commandBuffer;
+    std::vector<std::unique_ptr<System>> systems;
+
+    std::mutex mainLock;
+    std::vector<size_t> mainReady; // systemes mainThread prets a tourner
+    std::atomic<size_t> finished{0};
+    std::atomic<size_t> pending{0}; // taches envoyees au pool
+
+    static bool conflicts(const SystemAccess& a, const SystemAccess& b);
+
+    void addSystem(std::unique_ptr<System> system);
+    void schedule(size_t index);
+    void execute(size_t index);
+};
+
+/* exemple :
+    SystemScheduler scheduler(registry);
+
+    scheduler.add("transform", Reads<Hierarchy>{}, Writes<Transform>{}, [&](Registry& r) { transformSystem.update(r); });
+    scheduler.add("ai", Reads<Transform>{}, Writes<Velocity>{}, [&](Registry& r) { ... }); // apres transform
+    scheduler.add("audio", Reads<Transform>{}, Writes<AudioSource>{}, [&](Registry& r) { ... }); // apres transform, en meme temps que ai
+
+    scheduler.run(); // a chaque frame
+*/
+
+#endif // SYSTEMSCHEDULER_HPP
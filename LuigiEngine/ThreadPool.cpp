@@ -0,0 +1,134 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+using namespace std;
+
+thread_local size_t ThreadPool::threadIndex = 0;
+
+ThreadPool& ThreadPool::getInstance() {
+    // le main thread participe aussi, d'ou le - 1
+    static ThreadPool instance(max(1u, thread::hardware_concurrency()) - 1);
+    return instance;
+}
+
+ThreadPool::ThreadPool(size_t workerCount) {
+    for (size_t i = 0; i < workerCount + 1; i++)
+        queues.push_back(make_unique<Queue>());
+
+    for (size_t i = 1; i <= workerCount; i++)
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> guard(sleepLock);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (thread& worker : workers)
+        worker.join();
+}
+
+size_t ThreadPool::currentQueue() const {
+    return threadIndex < queues.size() ? threadIndex : 0;
+}
+
+void ThreadPool::submit(function<void()> job, atomic<size_t>& pending) {
+    pending.fetch_add(1);
+
+    Queue& queue = *queues[currentQueue()];
+    {
+        lock_guard<mutex> guard(queue.lock);
+        // un thread bloque dans un systeme peut voler la tache d'un autre : elle garde les acces de celui qui l'a soumise
+        queue.jobs.emplace_back([job = std::move(job), &pending, access = currentSystemAccess()]() {
+            const SystemAccess* previous = currentSystemAccess();
+            currentSystemAccess() = access;
+            job();
+            currentSystemAccess() = previous;
+            pending.fetch_sub(1);
+        });
+    }
+
+    {
+        lock_guard<mutex> guard(sleepLock);
+        queuedJobs.fetch_add(1);
+    }
+    wakeUp.notify_one();
+}
+
+bool ThreadPool::runOne(size_t index) {
+    function<void()> job;
+
+    // d'abord sa propre file (la tache la plus recente, encore chaude en cache)
+    {
+        Queue& own = *queues[index];
+        lock_guard<mutex> guard(own.lock);
+        if (!own.jobs.empty()) {
+            job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+        }
+    }
+
+    // sinon on vole la plus ancienne tache d'une autre file
+    for (size_t offset = 1; !job && offset < queues.size(); offset++) {
+        Queue& victim = *queues[(index + offset) % queues.size()];
+        lock_guard<mutex> guard(victim.lock);
+        if (!victim.jobs.empty()) {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+        }
+    }
+
+    if (!job)
+        return false;
+
+    queuedJobs.fetch_sub(1);
+    job();
+    return true;
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    threadIndex = index;
+
+    while (true) {
+        if (runOne(index))
+            continue;
+
+        unique_lock<mutex> guard(sleepLock);
+        wakeUp.wait(guard, [this]() { return stopping || queuedJobs > 0; });
+        if (stopping)
+            return;
+    }
+}
+
+void ThreadPool::wait(const atomic<size_t>& pending) {
+    size_t index = currentQueue();
+    while (pending.load() > 0) {
+        if (!runOne(index))
+            this_thread::yield();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grainSize, const function<void(size_t, size_t)>& func) {
+    if (count == 0)
+        return;
+
+    grainSize = max<size_t>(1, grainSize);
+
+    // un seul morceau ou pas de worker : pas la peine de passer par les files
+    if (count <= grainSize || workers.empty()) {
+        func(0, count);
+        return;
+    }
+
+    atomic<size_t> pending{0};
+    for (size_t begin = grainSize; begin < count; begin += grainSize) {
+        size_t end = min(count, begin + grainSize);
+        submit([&func, begin, end]() { func(begin, end); }, pending);
+    }
+
+    // le thread appelant traite le premier morceau puis aide les autres
+    func(0, grainSize);
+    wait(pending);
+}
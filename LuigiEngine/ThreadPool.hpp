@@ -0,0 +1,72 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct SystemAccess; // ECS.h
+
+// systeme qui tourne sur ce thread (nullptr hors d'un systeme : rien n'est verifie)
+// une tache du pool le recoit du thread qui l'a soumise, quel que soit le thread qui l'execute
+inline const SystemAccess*& currentSystemAccess() {
+    static thread_local const SystemAccess* access = nullptr;
+    return access;
+}
+
+// Pool de threads a vol de taches : chaque thread a sa file, il depile ses propres taches par la fin
+// et vole les taches des autres par le debut quand sa file est vide.
+// Le thread qui attend (wait / parallelFor) execute aussi des taches au lieu de dormir.
+class ThreadPool {
+public:
+    static ThreadPool& getInstance();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    // nombre de threads qui executent des taches, thread appelant compris
+    size_t getThreadCount() const { return queues.size(); }
+
+    // ajoute une tache, pending est incremente puis decremente quand la tache est finie
+    void submit(std::function<void()> job, std::atomic<size_t>& pending);
+
+    // execute des taches jusqu'a ce que pending retombe a 0
+    void wait(const std::atomic<size_t>& pending);
+
+    // execute une tache en attente s'il y en a une, pour aider le pool en attendant autre chose
+    bool tryRunOne() { return runOne(currentQueue()); }
+
+    // decoupe [0, count) en morceaux de grainSize et appelle func(debut, fin) sur chaque morceau en parallele
+    void parallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& func);
+
+private:
+    struct Queue {
+        std::deque<std::function<void()>> jobs;
+        std::mutex lock;
+    };
+
+    explicit ThreadPool(size_t workerCount);
+
+    void workerLoop(size_t index);
+    bool runOne(size_t index);
+    size_t currentQueue() const;
+
+    std::vector<std::unique_ptr<Queue>> queues; // queues[0] : threads exterieurs au pool (main)
+    std::vector<std::thread> workers;
+
+    std::mutex sleepLock;
+    std::condition_variable wakeUp;
+    std::atomic<size_t> queuedJobs{0};
+    std::atomic<bool> stopping{false};
+
+    static thread_local size_t threadIndex; // 0 hors du pool
+};
+
+#endif // THREADPOOL_HPP
@@ -1,29 +1,21 @@
-extern int* nbLocalMatrixUpdate;
-extern int* nbGlobalMatrixUpdate;
 extern bool* optimizeMVP;
 
 #include "Transform.hpp"
+#include "Stats.hpp"
+#include "ThreadPool.hpp"
+#include "TransformMath.hpp"
 
 using namespace glm;
 using namespace std;
 
+static const Stats::Id localMatrixStat = Stats::getInstance().counter("matrices modele locales");
+static const Stats::Id globalMatrixStat = Stats::getInstance().counter("matrices modele globales");
 
 
-void Transform::computeLocalModelMatrix()
-{
-	if (*optimizeMVP && upToDateLocal) return;
 
-	nbLocalMatrixUpdate = new int(*nbLocalMatrixUpdate + 1);
-
-	// Si on a pas donné de rotation en quaternion alors on calcule la rotation avec les angles d'Euler
-	if (localRot == mat4(1.0f))
-		localRot = toMat4(quat(radians(localEulerRot)));
-
-	// translation * rotation * scale (also know as TRS matrix)
-	localModel = translate(mat4(1.0f), localPos) * localRot * scale(mat4(1.0f), localScale);
-
-	upToDateLocal = true;
-	changed = true;
+mat4x3 Transform::getLocalModel() const {
+	// translation * rotation * scale (also know as TRS matrix), compose directement sans multiplier de matrices
+	return composeTRS(localPos, localRot, localScale);
 }
 
 void Transform::addPos(const vec3& vec) {
@@ -36,18 +28,23 @@ void Transform::setPos(vec3 vec) {
 	upToDateLocal = false;
 }
 
+vec3 Transform::getEulerRot() const {
+	return degrees(eulerAngles(localRot));
+}
+
 void Transform::addEulerRot(const vec3& vec) {
-	localEulerRot += vec;
+	// le delta est compose directement avec le quaternion : repasser par eulerAngles bloquerait le lacet a +-90 degres
+	localRot = normalize(quat(radians(vec)) * localRot);
 	upToDateLocal = false;
 }
 
 void Transform::setEulerRot(vec3 vec) {
-	localEulerRot = vec;
+	localRot = quat(radians(vec));
 	upToDateLocal = false;
 }
 
 void Transform::setRot(const quat& quatRot) {
-	localRot = toMat4(quatRot);
+	localRot = quatRot;
 	upToDateLocal = false;
 }
 
@@ -62,42 +59,319 @@ void Transform::setScale(vec3 vec) {
 }
 
 void Transform::computeGlobalModelMatrix() {
-	computeLocalModelMatrix();
-	globalModel = localModel;
-	nbGlobalMatrixUpdate = new int(*nbGlobalMatrixUpdate + 1);
-	upToDateGlobal = true;
-	changed = true;
+	if (updateGlobalModelMatrix(nullptr) || !*optimizeMVP) Stats::getInstance().add(localMatrixStat);
+	Stats::getInstance().add(globalMatrixStat);
+}
+
+void Transform::computeGlobalModelMatrix(const mat4x3& parentModel) {
+	if (updateGlobalModelMatrix(&parentModel) || !*optimizeMVP) Stats::getInstance().add(localMatrixStat);
+	Stats::getInstance().add(globalMatrixStat);
+}
+
+bool Transform::updateGlobalModelMatrix(const mat4x3* parentModel) {
+	const bool localChanged = !upToDateLocal;
+	if (parentModel) multiplyAffine(*parentModel, getLocalModel(), globalModel);
+	else globalModel = getLocalModel();
+	upToDateLocal = true;
+	return localChanged;
+}
+
+
+TransformSystem::TransformSystem(Registry & registry) {
+    structureObservers = {
+        &registry.observe<Transform>(ObserverEvent::Construct),
+        &registry.observe<Transform>(ObserverEvent::Destroy),
+        &registry.observe<Hierarchy>(ObserverEvent::Construct),
+        &registry.observe<Hierarchy>(ObserverEvent::Update),
+        &registry.observe<Hierarchy>(ObserverEvent::Destroy),
+        &registry.observe<PreviousTransform>(ObserverEvent::Construct),
+        &registry.observe<PreviousTransform>(ObserverEvent::Destroy),
+    };
+    localChanges = &registry.observe<Transform>(ObserverEvent::Update);
+}
+
+void TransformSystem::prepare(Registry & registry) {
+    for (Observer * observer : structureObservers) {
+        if (!observer->empty()) {
+            observer->clear();
+            structureChanged = true;
+        }
+    }
+    if (structureChanged) {
+        rebuild(registry);
+        structureChanged = false;
+    }
+    if (transformLayout != registry.layoutVersion<Transform>() || previousLayout != registry.layoutVersion<PreviousTransform>())
+        refreshTransforms(registry);
+}
+
+void TransformSystem::run(Registry & registry, size_t grainSize, bool parallel) {
+    prepare(registry);
+
+    const bool all = fullUpdate || !*optimizeMVP;
+    fullUpdate = false;
+    // rien de signale et aucune interpolation a terminer : scene immobile, aucun noeud n'est parcouru
+    if (!all && localChanges->empty() && moving.empty()) return;
+
+    if (++pass == 0) {
+        fill(updatedPass.begin(), updatedPass.end(), 0);
+        pass = 1;
+    }
+
+    roots.clear();
+    for (Entity entity : localChanges->take()) {
+        const uint32_t index = entityIndex(entity) < nodeIndex.size() ? nodeIndex[entityIndex(entity)] : NO_NODE;
+        if (index != NO_NODE && nodes[index] == entity) roots.push_back(index);
+    }
+
+    // les markChanged de ce passage sont des resultats, pas des modifications locales a traiter au prochain
+    localChanges->setPaused(true);
+    // beaucoup de noeuds signales : parcourir tous les niveaux revient moins cher que suivre les sous-arbres
+    const bool scan = all || roots.size() * 8 > nodes.size();
+    if (scan) {
+        for (uint32_t root : roots) updatedPass[root] = pass; // lus par scanNodes : les deux chemins recalculent les memes noeuds
+        updateAll(registry, grainSize, parallel, all);
+    } else {
+        updateSubtrees(registry, grainSize, parallel);
+    }
+    stopMoving(registry);
+    localChanges->setPaused(false);
+
+    // seuls les noeuds recalcules peuvent etre en mouvement (stopMoving a arrete les autres)
+    moving.clear();
+    if (scan) {
+        for (size_t i = 0; i < nodes.size(); i++) {
+            if (previous[i] && previous[i]->moving) moving.push_back(uint32_t(i));
+        }
+    } else {
+        for (uint32_t i : updated) {
+            if (previous[i] && previous[i]->moving) moving.push_back(i);
+        }
+    }
 }
 
-void Transform::computeGlobalModelMatrix(const mat4& parentModel) {
-	computeGlobalModelMatrix();
-	globalModel = parentModel * globalModel;
+void TransformSystem::updateAll(Registry & registry, size_t grainSize, bool parallel, bool all) {
+    // parents avant enfants : un niveau ne depend que des niveaux precedents, ses noeuds sont repartis sur les threads,
+    // les petits niveaux (un seul morceau) restent sur le thread appelant
+    for (size_t level = 0; level + 1 < levels.size(); level++) {
+        const size_t begin = levels[level], end = levels[level + 1];
+        if (!parallel) {
+            scanNodes(registry, begin, end, all);
+            continue;
+        }
+        ThreadPool::getInstance().parallelFor(end - begin, grainSize, [&](size_t first, size_t last) {
+            scanNodes(registry, begin + first, begin + last, all);
+        });
+    }
 }
 
+void TransformSystem::updateSubtrees(Registry & registry, size_t grainSize, bool parallel) {
+    // niveau par niveau depuis les noeuds signales : les enfants d'un noeud sont contigus dans le niveau suivant,
+    // un noeud signale deja atteint depuis un ancetre n'est pris qu'une fois
+    auto visit = [&](uint32_t node) {
+        if (updatedPass[node] == pass) return;
+        updatedPass[node] = pass;
+        updated.push_back(node);
+    };
 
-void TransformSystem::update(Registry & registry) {
-    for (Entity entity : registry.view<Transform>()) {
-        if (!registry.has<Hierarchy>(entity)) {
-            computeGlobalTransform(entity, registry, glm::mat4(1.0f));
+    sort(roots.begin(), roots.end());
+    updated.clear();
+    size_t root = 0, levelBegin = 0;
+    for (size_t level = 0; level + 1 < levels.size(); level++) {
+        for (; root < roots.size() && roots[root] < levels[level + 1]; root++) visit(roots[root]);
 
+        const size_t levelEnd = updated.size();
+        if (levelBegin == levelEnd) {
+            if (root == roots.size()) break;
+            continue;
+        }
+        const uint32_t * indices = updated.data() + levelBegin;
+        if (parallel) {
+            ThreadPool::getInstance().parallelFor(levelEnd - levelBegin, grainSize, [&](size_t first, size_t last) {
+                updateNodes(registry, indices + first, last - first);
+            });
         } else {
-            const auto & hierarchy = registry.get<Hierarchy>(entity);
-            if (hierarchy.parent == INVALID) {
-                computeGlobalTransform(entity, registry, glm::mat4(1.0f));
+            updateNodes(registry, indices, levelEnd - levelBegin);
+        }
+
+        for (size_t k = levelBegin; k < levelEnd; k++) {
+            const uint32_t node = updated[k];
+            for (uint32_t child = firstChild[node]; child < firstChild[node + 1]; child++) visit(child);
+        }
+        levelBegin = levelEnd;
+    }
+}
+
+void TransformSystem::scanNodes(Registry & registry, size_t begin, size_t end, bool all) {
+    // un noeud n'est recalcule que s'il a ete signale ou qu'un ancetre a ete recalcule (une transform modifiee sans
+    // patch / markChanged ne l'est pas, quel que soit le chemin pris)
+    thread_local vector<uint32_t> indices;
+    indices.clear();
+    for (size_t i = begin; i < end; i++) {
+        if (all || updatedPass[i] == pass || (parents[i] >= 0 && updatedPass[parents[i]] == pass)) {
+            updatedPass[i] = pass;
+            indices.push_back(uint32_t(i));
+        }
+    }
+    updateNodes(registry, indices.data(), indices.size());
+}
+
+void TransformSystem::updateNodes(Registry & registry, const uint32_t * indices, size_t count) {
+    // par blocs : les transforms locales sont rassemblees et composees en un lot, puis multipliees en un lot
+    // par la matrice globale de leur parent (tous les noeuds d'un appel sont du meme niveau : les parents sont a jour)
+    constexpr size_t BLOCK = 128;
+    vec3 positions[BLOCK], scales[BLOCK];
+    quat rotations[BLOCK];
+    mat4x3 models[BLOCK];
+    const mat4x3 * parentModels[BLOCK];
+
+    int64_t localCount = 0;
+    for (size_t blockBegin = 0; blockBegin < count; blockBegin += BLOCK) {
+        const uint32_t * block = indices + blockBegin;
+        const size_t size = min(BLOCK, count - blockBegin);
+        for (size_t k = 0; k < size; k++) {
+            const Transform & transform = *transforms[block[k]];
+            positions[k] = transform.localPos;
+            rotations[k] = transform.localRot;
+            scales[k] = transform.localScale;
+            parentModels[k] = parents[block[k]] < 0 ? nullptr : &transforms[parents[block[k]]]->globalModel;
+        }
+        composeTRS(positions, rotations, scales, models, size);
+        multiplyAffine(parentModels, models, models, size);
+
+        for (size_t k = 0; k < size; k++) {
+            const uint32_t i = block[k];
+            Transform & transform = *transforms[i];
+            PreviousTransform * history = previous[i];
+
+            // la matrice du pas precedent est gardee avant d'etre remplacee
+            if (history) history->model = transform.globalModel;
+            transform.globalModel = models[k];
+            localCount += !transform.upToDateLocal || !*optimizeMVP;
+            transform.upToDateLocal = true;
+            registry.markChanged<Transform>(nodes[i]);
+
+            if (history) {
+                if (!history->initialized) history->model = transform.globalModel; // premier pas : rien a interpoler
+                history->moving = history->model != transform.globalModel;
+                history->initialized = true;
             }
         }
     }
+
+    // compteurs du thread appelant, une seule fois par morceau
+    Stats::getInstance().add(localMatrixStat, localCount);
+    Stats::getInstance().add(globalMatrixStat, int64_t(count));
+}
+
+void TransformSystem::stopMoving(Registry & registry) {
+    // un noeud interpole qui s'arrete est encore marque modifie une fois, pour que le rendu finisse l'interpolation sur la position atteinte
+    for (uint32_t i : moving) {
+        PreviousTransform * history = previous[i];
+        if (updatedPass[i] == pass || !history->moving) continue;
+        history->model = transforms[i]->globalModel;
+        history->moving = false;
+        registry.markChanged<Transform>(nodes[i]);
+    }
+}
+
+void TransformSystem::rebuild(Registry & registry) {
+    nodes.clear();
+    parents.clear();
+
+    // un enfant est atteint depuis son parent, toute transform qui n'est l'enfant de personne est une racine
+    vector<bool> isChild;
+    registry.view<const Hierarchy>().withDisabled().each([&](Entity entity, const Hierarchy & hierarchy) {
+        for (Entity child : hierarchy.children) {
+            if (!registry.valid(child)) continue; // handle perime : son index peut deja etre une autre racine
+            if (entityIndex(child) >= isChild.size()) isChild.resize(entityIndex(child) + 1, false);
+            isChild[entityIndex(child)] = true;
+        }
+    });
+
+    vector<bool> visited; // un enfant liste deux fois n'est pris qu'une fois
+    auto visit = [&](Entity entity, int32_t parent) {
+        if (entityIndex(entity) >= visited.size()) visited.resize(entityIndex(entity) + 1, false);
+        if (visited[entityIndex(entity)]) return;
+        visited[entityIndex(entity)] = true;
+        nodes.push_back(entity);
+        parents.push_back(parent);
+    };
+
+    for (Entity entity : registry.view<const Transform>().withDisabled()) {
+        if (entityIndex(entity) >= isChild.size() || !isChild[entityIndex(entity)]) visit(entity, -1);
+    }
+
+    // niveau suivant : les enfants des noeuds du niveau courant
+    levels.assign(1, 0);
+    firstChild.clear();
+    while (levels.back() < nodes.size()) {
+        size_t begin = levels.back(), end = nodes.size();
+        for (size_t i = begin; i < end; i++) {
+            firstChild.push_back(uint32_t(nodes.size()));
+            if (!registry.has<Hierarchy>(nodes[i])) continue;
+            for (Entity child : registry.get<Hierarchy>(nodes[i]).children) {
+                if (registry.valid(child) && registry.has<Transform>(child)) visit(child, int32_t(i));
+            }
+        }
+        levels.push_back(end);
+    }
+    firstChild.push_back(uint32_t(nodes.size()));
+
+    nodeIndex.assign(visited.size(), NO_NODE);
+    for (size_t i = 0; i < nodes.size(); i++) nodeIndex[entityIndex(nodes[i])] = uint32_t(i);
+
+    // les parents ont pu changer : tout est recalcule au prochain passage
+    updatedPass.assign(nodes.size(), 0);
+    moving.clear();
+    fullUpdate = true;
+
+    refreshTransforms(registry);
+}
+
+void TransformSystem::refreshTransforms(Registry & registry) {
+    transforms.resize(nodes.size());
+    previous.resize(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++) {
+        transforms[i] = &registry.get<Transform>(nodes[i]);
+        previous[i] = registry.has<PreviousTransform>(nodes[i]) ? &registry.get<PreviousTransform>(nodes[i]) : nullptr;
+    }
+    transformLayout = registry.layoutVersion<Transform>();
+    previousLayout = registry.layoutVersion<PreviousTransform>();
+}
+
+
+void TransformSystem::updateRecursive(Registry & registry) {
+    // comme run : les markChanged du parcours ne sont pas des modifications locales,
+    // et tout est recalcule, les noeuds deja signales n'ont plus rien a attendre du prochain update
+    localChanges->setPaused(true);
+
+    // racines sans hierarchie
+    registry.query<Transform>(exclude<Hierarchy>).each([&](Entity entity, Transform & transform) {
+        computeGlobalTransform(entity, registry, glm::mat4x3(1.0f));
+    });
+
+    // racines d'une hierarchie, les enfants sont traites recursivement
+    registry.query<Transform, const Hierarchy>().each([&](Entity entity, Transform & transform, const Hierarchy & hierarchy) {
+        if (hierarchy.parent == INVALID) {
+            computeGlobalTransform(entity, registry, glm::mat4x3(1.0f));
+        }
+    });
+
+    localChanges->setPaused(false);
+    localChanges->clear();
 }
 
 
-void TransformSystem::computeGlobalTransform(Entity entity, Registry & registry, const glm::mat4 & parentModel) {
+void TransformSystem::computeGlobalTransform(Entity entity, Registry & registry, const glm::mat4x3 & parentModel) {
     auto& transform = registry.get<Transform>(entity);
     transform.computeGlobalModelMatrix(parentModel);
+    registry.markChanged<Transform>(entity);
 
     if (registry.has<Hierarchy>(entity)) {
         auto & hierarchy = registry.get<Hierarchy>(entity);
         for (Entity child : hierarchy.children) {
-            computeGlobalTransform(child, registry, transform.getGlobalModel());
+            computeGlobalTransform(child, registry, transform.globalModel);
         }
     }
 }
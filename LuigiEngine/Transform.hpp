@@ -11,48 +11,46 @@
 
 using namespace glm;
 
+//position, rotation et echelle locales, matrice globale affine (la derniere ligne 0 0 0 1 n'est pas stockee) :
+//environ 90 octets par transform. La matrice locale est composee a la demande, les angles d'Euler sont convertis
+//une fois le TransformSystem passe, modifier via registry.patch<Transform> (ou markChanged) pour qu'il voie le changement
 class Transform
 {
-    bool upToDateLocal = false;
     vec3 localPos{0.0f, 0.0f, 0.0f};
-    vec3 localEulerRot{0.0f, 0.0f, 0.0f};
-    mat4 localRot;
+    quat localRot{1.0f, 0.0f, 0.0f, 0.0f};
     vec3 localScale{1.0f, 1.0f, 1.0f};
-    mat4 localModel{1.0f};
-    
+    bool upToDateLocal = false; //faux tant que globalModel n'a pas ete recalculee apres un changement local
 
-    
+    friend class TransformSystem; //lit les champs locaux par lots
 
 public:
 
-    void onAttach(Registry & registry, Entity entity){};
-    void onDetach(Registry & registry, Entity entity){};
-
-    bool upToDateGlobal = false;
-    bool changed = true;
-
-    void computeLocalModelMatrix();
-    mat4 globalModel{1.0f};
+    mat4x3 globalModel{1.0f};
 
     bool isUpToDateLocal() { return upToDateLocal; }
     vec3 getPos() { return localPos; }
     void addPos(const vec3& vec);
     void setPos(vec3 vec);
-    vec3 getEulerRot() { return localEulerRot; }
+    vec3 getEulerRot() const; //en degres
     void addEulerRot(const vec3& vec);
     void setEulerRot(vec3 vec);
-    mat4 getRot() { return localRot; }
+    quat getRot() { return localRot; }
     void setRot(const quat& quatRot);
     vec3 getScale() { return localScale; }
     void addScale(const vec3& vec);
     void setScale(vec3 vec);
-    mat4 getGlobalModel() { return globalModel; }
+    mat4x3 getLocalModel() const;
+    mat4 getGlobalModel() const { return mat4(globalModel); }
     void computeGlobalModelMatrix();
-    void computeGlobalModelMatrix(const mat4& parentModel);
+    void computeGlobalModelMatrix(const mat4x3& parentModel);
+
+    //meme calcul sans compter dans les Stats, renvoie vrai si la transform locale avait change
+    bool updateGlobalModelMatrix(const mat4x3* parentModel); //nullptr pour une racine
 };
 
 
 //pour l' heritage des transformations
+//apres avoir modifie parent / children a la main, passer par registry.patch<Hierarchy> pour que le TransformSystem le voie
 struct Hierarchy {
     Entity parent = INVALID;
     std::vector<Entity> children;
@@ -67,6 +65,11 @@ struct Hierarchy {
         children.push_back(child);
     }
 
+    void remapEntities(const EntityRemap& remap) {
+        if (parent != INVALID) parent = remap(parent);
+        for (Entity& child : children) child = remap(child);
+    }
+
     void onAttach(Registry& registry, Entity entity) {
         if (parent != INVALID) {
             if (registry.has<Hierarchy>(parent)) {
@@ -87,12 +90,67 @@ struct Hierarchy {
 };
 
 
+//matrice globale au pas de simulation precedent, pour interpoler le rendu entre deux pas
+//(seulement sur les entites dessinees et les cameras : Transform reste compacte)
+//tenue a jour par le TransformSystem, lue par le CameraSystem et le RenderSystem
+struct PreviousTransform {
+    mat4x3 model{1.0f};
+    bool moving = false; //globalModel a change au dernier pas : model et globalModel different
+    bool initialized = false; //faux jusqu'au premier passage du TransformSystem (pas d'interpolation depuis l'identite)
+};
+
+
+//seules les transforms signalees par patch / markChanged et leurs descendants sont recalculees, et marquees modifiees
+//dans le registry (registry.changedSince<Transform>) : sans signalement ni interpolation a terminer, le passage ne parcourt rien
+//la hierarchie est gardee a plat, niveau par niveau (un parent est toujours avant ses enfants) : le calcul des matrices
+//globales est une seule boucle sur des tableaux, sans recursion ni recherche dans le registry
+//elle n'est reconstruite que quand des Transform / Hierarchy sont ajoutes, enleves ou qu'une Hierarchy est modifiee
+//un passage = un pas de simulation : la matrice globale d'avant est gardee dans le PreviousTransform du noeud s'il en a un
 class TransformSystem{
 public:
-    void update(Registry & registry);
+    explicit TransformSystem(Registry & registry); //a creer avant les entites
+
+    void update(Registry & registry) { run(registry, 0, false); }
+
+    //meme resultat, chaque niveau de la hierarchie est reparti sur le ThreadPool par morceaux de grainSize noeuds
+    void par_update(Registry & registry, size_t grainSize = 1024) { run(registry, grainSize, true); }
+
+    //ancien parcours recursif depuis les racines, garde comme reference pour verifier update
+    void updateRecursive(Registry & registry);
 
 private:
-    void computeGlobalTransform(Entity entity, Registry & registry, const glm::mat4 & parentModel);
+    static constexpr uint32_t NO_NODE = UINT32_MAX;
+
+    std::vector<Observer*> structureObservers; //un evenement sur l'un d'eux oblige a reconstruire
+    bool structureChanged = true;
+    Observer * localChanges; //Transform modifiees par patch / markChanged depuis le dernier passage
+
+    std::vector<Entity> nodes; //niveau par niveau
+    std::vector<int32_t> parents; //index du parent dans nodes, -1 pour une racine
+    std::vector<uint32_t> levels; //debut de chaque niveau dans nodes, puis nodes.size()
+    std::vector<uint32_t> firstChild; //enfants du noeud i : [firstChild[i], firstChild[i + 1]) dans le niveau suivant
+    std::vector<uint32_t> nodeIndex; //entityIndex -> index dans nodes, NO_NODE hors hierarchie
+    std::vector<Transform*> transforms; //composant de chaque noeud
+    uint32_t transformLayout = 0; //layoutVersion du storage de Transform quand transforms a ete rempli
+    std::vector<PreviousTransform*> previous; //etat precedent de chaque noeud, nullptr s'il n'est pas interpole
+    uint32_t previousLayout = 0; //idem pour PreviousTransform
+    std::vector<uint32_t> updatedPass; //dernier passage ou le noeud a ete recalcule, lu par ses enfants
+    uint32_t pass = 0;
+    std::vector<uint32_t> roots; //noeuds signales au debut du passage
+    std::vector<uint32_t> updated; //noeuds recalcules par updateSubtrees, niveau par niveau
+    std::vector<uint32_t> moving; //noeuds interpoles dont la matrice a change au dernier passage
+    bool fullUpdate = true; //apres une reconstruction, tous les noeuds sont recalcules
+
+    void run(Registry & registry, size_t grainSize, bool parallel);
+    void prepare(Registry & registry); //reconstruit / rafraichit les tableaux si besoin
+    void updateAll(Registry & registry, size_t grainSize, bool parallel, bool all); //parcourt tous les noeuds
+    void updateSubtrees(Registry & registry, size_t grainSize, bool parallel); //seulement les sous-arbres des noeuds signales
+    void scanNodes(Registry & registry, size_t begin, size_t end, bool all);
+    void updateNodes(Registry & registry, const uint32_t * indices, size_t count);
+    void stopMoving(Registry & registry);
+    void rebuild(Registry & registry);
+    void refreshTransforms(Registry & registry);
+    void computeGlobalTransform(Entity entity, Registry & registry, const glm::mat4x3 & parentModel);
 };
 
 #endif //TRANSFORM_H
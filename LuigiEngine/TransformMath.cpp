@@ -0,0 +1,123 @@
+#include "TransformMath.hpp"
+
+using namespace glm;
+
+void composeTRS(const vec3* positions, const quat* rotations, const vec3* scales, mat4x3* out, size_t count) {
+    size_t i = 0;
+
+#ifdef LUIGI_TRANSFORM_SSE
+    // chaque voie d'un registre est une transform differente : 4 matrices calculees ensemble,
+    // puis transposees pour ecrire chaque colonne d'un coup
+    const __m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f), zero = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4) {
+        const quat* q = rotations + i;
+        const vec3* p = positions + i;
+        const vec3* s = scales + i;
+        const __m128 x = _mm_setr_ps(q[0].x, q[1].x, q[2].x, q[3].x);
+        const __m128 y = _mm_setr_ps(q[0].y, q[1].y, q[2].y, q[3].y);
+        const __m128 z = _mm_setr_ps(q[0].z, q[1].z, q[2].z, q[3].z);
+        const __m128 w = _mm_setr_ps(q[0].w, q[1].w, q[2].w, q[3].w);
+
+        const __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+        const __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+        const __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+        const __m128 sx = _mm_setr_ps(s[0].x, s[1].x, s[2].x, s[3].x);
+        const __m128 sy = _mm_setr_ps(s[0].y, s[1].y, s[2].y, s[3].y);
+        const __m128 sz = _mm_setr_ps(s[0].z, s[1].z, s[2].z, s[3].z);
+
+        // colonne c, ligne r : m<c><r>
+        __m128 m00 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+        __m128 m01 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+        __m128 m02 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+        __m128 m10 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+        __m128 m11 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+        __m128 m12 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+        __m128 m20 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+        __m128 m21 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+        __m128 m22 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+        __m128 m30 = _mm_setr_ps(p[0].x, p[1].x, p[2].x, p[3].x);
+        __m128 m31 = _mm_setr_ps(p[0].y, p[1].y, p[2].y, p[3].y);
+        __m128 m32 = _mm_setr_ps(p[0].z, p[1].z, p[2].z, p[3].z);
+        __m128 m03 = zero, m13 = zero, m23 = zero, m33 = zero; // 4e ligne, jamais ecrite
+
+        _MM_TRANSPOSE4_PS(m00, m01, m02, m03);
+        _MM_TRANSPOSE4_PS(m10, m11, m12, m13);
+        _MM_TRANSPOSE4_PS(m20, m21, m22, m23);
+        _MM_TRANSPOSE4_PS(m30, m31, m32, m33);
+
+        const __m128 columns[4][4] = {{m00, m10, m20, m30}, {m01, m11, m21, m31},
+                                      {m02, m12, m22, m32}, {m03, m13, m23, m33}};
+        for (int l = 0; l < 4; l++) {
+            for (int c = 0; c < 4; c++) storeColumn(out[i + l][c], columns[l][c]);
+        }
+    }
+#endif
+
+    // reste (ou tout, sans SSE)
+    for (; i < count; i++) {
+        out[i] = composeTRS(positions[i], rotations[i], scales[i]);
+    }
+}
+
+void multiplyAffine(const mat4x3* const* parents, const mat4x3* locals, mat4x3* out, size_t count) {
+    size_t i = 0;
+
+#ifdef LUIGI_TRANSFORM_SSE
+    // une mat4x3 est 12 floats contigus : la locale est lue et le resultat ecrit en 3 blocs de 4 floats
+    // (sans passer par storeColumn), et les colonnes du parent restent en registres tant que les freres se suivent.
+    // Memes operations dans le meme ordre que la version a une matrice : resultats identiques au bit pres
+    const mat4x3* parent = nullptr;
+    __m128 p0 = _mm_setzero_ps(), p1 = p0, p2 = p0, p3 = p0;
+    for (; i < count; i++) {
+        const float* local = &locals[i][0][0];
+        const __m128 l0 = _mm_loadu_ps(local);     // c0.x c0.y c0.z c1.x
+        const __m128 l1 = _mm_loadu_ps(local + 4); // c1.y c1.z c2.x c2.y
+        const __m128 l2 = _mm_loadu_ps(local + 8); // c2.z c3.x c3.y c3.z
+        float* result = &out[i][0][0];             // peut etre local : tout est lu avant d'ecrire
+
+        if (!parents[i]) {
+            _mm_storeu_ps(result, l0);
+            _mm_storeu_ps(result + 4, l1);
+            _mm_storeu_ps(result + 8, l2);
+            continue;
+        }
+        if (parents[i] != parent) {
+            parent = parents[i];
+            const float* values = &(*parent)[0][0];
+            p0 = _mm_loadu_ps(values);
+            p1 = _mm_loadu_ps(values + 3);
+            p2 = _mm_loadu_ps(values + 6);
+            const __m128 last = _mm_loadu_ps(values + 8);
+            p3 = _mm_shuffle_ps(last, last, _MM_SHUFFLE(3, 3, 2, 1));
+        }
+
+        const __m128 c0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p0, _mm_shuffle_ps(l0, l0, _MM_SHUFFLE(0, 0, 0, 0))),
+                                                _mm_mul_ps(p1, _mm_shuffle_ps(l0, l0, _MM_SHUFFLE(1, 1, 1, 1)))),
+                                     _mm_mul_ps(p2, _mm_shuffle_ps(l0, l0, _MM_SHUFFLE(2, 2, 2, 2))));
+        const __m128 c1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p0, _mm_shuffle_ps(l0, l0, _MM_SHUFFLE(3, 3, 3, 3))),
+                                                _mm_mul_ps(p1, _mm_shuffle_ps(l1, l1, _MM_SHUFFLE(0, 0, 0, 0)))),
+                                     _mm_mul_ps(p2, _mm_shuffle_ps(l1, l1, _MM_SHUFFLE(1, 1, 1, 1))));
+        const __m128 c2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p0, _mm_shuffle_ps(l1, l1, _MM_SHUFFLE(2, 2, 2, 2))),
+                                                _mm_mul_ps(p1, _mm_shuffle_ps(l1, l1, _MM_SHUFFLE(3, 3, 3, 3)))),
+                                     _mm_mul_ps(p2, _mm_shuffle_ps(l2, l2, _MM_SHUFFLE(0, 0, 0, 0))));
+        const __m128 c3 = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(p0, _mm_shuffle_ps(l2, l2, _MM_SHUFFLE(1, 1, 1, 1))),
+                                                           _mm_mul_ps(p1, _mm_shuffle_ps(l2, l2, _MM_SHUFFLE(2, 2, 2, 2)))),
+                                                _mm_mul_ps(p2, _mm_shuffle_ps(l2, l2, _MM_SHUFFLE(3, 3, 3, 3)))),
+                                     p3);
+
+        // 4 colonnes xyz_ -> 3 blocs de 4 floats
+        const __m128 t0 = _mm_shuffle_ps(c0, c1, _MM_SHUFFLE(0, 0, 2, 2)); // c0.z c0.z c1.x c1.x
+        const __m128 t2 = _mm_shuffle_ps(c2, c3, _MM_SHUFFLE(0, 0, 2, 2)); // c2.z c2.z c3.x c3.x
+        _mm_storeu_ps(result, _mm_shuffle_ps(c0, t0, _MM_SHUFFLE(2, 0, 1, 0)));
+        _mm_storeu_ps(result + 4, _mm_shuffle_ps(c1, c2, _MM_SHUFFLE(1, 0, 2, 1)));
+        _mm_storeu_ps(result + 8, _mm_shuffle_ps(t2, c3, _MM_SHUFFLE(2, 1, 2, 0)));
+    }
+#endif
+
+    // sans SSE
+    for (; i < count; i++) {
+        if (parents[i]) multiplyAffine(*parents[i], locals[i], out[i]);
+        else out[i] = locals[i];
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef TRANSFORMMATH_HPP
+#define TRANSFORMMATH_HPP
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LUIGI_TRANSFORM_SSE 1
+#include <emmintrin.h>
+#endif
+
+// Matrices de Transform sans passer par les multiplications 4x4 generiques de glm.
+// Toutes les matrices sont affines et stockees en mat4x3 : la derniere ligne (0 0 0 1) n'est ni stockee ni calculee.
+// SSE2 si disponible (toujours le cas en x86-64), sinon version scalaire equivalente.
+
+// colonnes de rotation d'un quaternion unitaire (meme resultat que glm::mat3_cast)
+inline glm::mat3 rotationMatrix(const glm::quat& q) {
+    const float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    const float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    const float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+    return glm::mat3(glm::vec3(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy)),
+                     glm::vec3(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx)),
+                     glm::vec3(2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy)));
+}
+
+// translate(position) * rotation * scale(scale) : chaque colonne de rotation est mise a l'echelle, la translation va dans la derniere
+inline glm::mat4x3 composeTRS(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale) {
+    const glm::mat3 columns = rotationMatrix(rotation);
+    return glm::mat4x3(columns[0] * scale.x, columns[1] * scale.y, columns[2] * scale.z, position);
+}
+
+#ifdef LUIGI_TRANSFORM_SSE
+// ecrit les 3 premieres voies de column dans une colonne vec3, sans deborder apres la matrice
+inline void storeColumn(glm::vec3& out, __m128 column) {
+    alignas(16) float values[4];
+    _mm_store_ps(values, column);
+    out = glm::vec3(values[0], values[1], values[2]);
+}
+#endif
+
+// out = parent * local pour deux matrices affines (out peut etre local ou parent)
+inline void multiplyAffine(const glm::mat4x3& parent, const glm::mat4x3& local, glm::mat4x3& out) {
+#ifdef LUIGI_TRANSFORM_SSE
+    // les colonnes 0 a 2 sont lues sur 4 floats (la 4e voie deborde sur la colonne suivante et n'est pas utilisee),
+    // la derniere l'est champ par champ pour ne pas lire apres la matrice
+    const __m128 p0 = _mm_loadu_ps(&parent[0][0]);
+    const __m128 p1 = _mm_loadu_ps(&parent[1][0]);
+    const __m128 p2 = _mm_loadu_ps(&parent[2][0]);
+    const __m128 p3 = _mm_setr_ps(parent[3][0], parent[3][1], parent[3][2], 0.0f);
+    __m128 columns[4];
+    for (int j = 0; j < 4; j++) {
+        columns[j] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p0, _mm_set1_ps(local[j][0])),
+                                           _mm_mul_ps(p1, _mm_set1_ps(local[j][1]))),
+                                _mm_mul_ps(p2, _mm_set1_ps(local[j][2])));
+    }
+    columns[3] = _mm_add_ps(columns[3], p3);
+    for (int j = 0; j < 4; j++) storeColumn(out[j], columns[j]);
+#else
+    glm::mat4x3 result;
+    for (int j = 0; j < 4; j++)
+        result[j] = parent[0] * local[j][0] + parent[1] * local[j][1] + parent[2] * local[j][2];
+    result[3] += parent[3];
+    out = result;
+#endif
+}
+
+// matrice entre from (t = 0) et to (t = 1), pour dessiner entre deux pas de simulation :
+// la translation est interpolee lineairement, chaque colonne de rotation / echelle garde une longueur interpolee
+// et une direction interpolee puis normalisee (pas de decomposition en position / quaternion / echelle)
+inline glm::mat4x3 interpolateAffine(const glm::mat4x3& from, const glm::mat4x3& to, float t) {
+    glm::mat4x3 result;
+    for (int j = 0; j < 3; j++) {
+        const float fromLength = glm::length(from[j]), toLength = glm::length(to[j]);
+        const glm::vec3 direction = glm::mix(from[j] / fromLength, to[j] / toLength, t);
+        const float length = glm::length(direction);
+        // colonne nulle (echelle 0) ou directions opposees : pas de direction moyenne, on garde la plus proche
+        if (!(fromLength > 0.0f && toLength > 0.0f && length > 1e-6f)) result[j] = t < 0.5f ? from[j] : to[j];
+        else result[j] = direction * (glm::mix(fromLength, toLength, t) / length);
+    }
+    result[3] = glm::mix(from[3], to[3], t);
+    return result;
+}
+
+// versions par lots, sur des tableaux de count elements
+
+// out[i] = translate(positions[i]) * rotations[i] * scale(scales[i]), 4 transforms par iteration en SSE
+void composeTRS(const glm::vec3* positions, const glm::quat* rotations, const glm::vec3* scales, glm::mat4x3* out, size_t count);
+
+// out[i] = *parents[i] * locals[i], parents[i] == nullptr pour une racine (out[i] = locals[i]), out peut etre locals
+// meme resultat au bit pres que multiplyAffine(parent, local, out) ; plus rapide quand les freres se suivent (parent garde en registres)
+void multiplyAffine(const glm::mat4x3* const* parents, const glm::mat4x3* locals, glm::mat4x3* out, size_t count);
+
+#endif // TRANSFORMMATH_HPP
@@ -12,11 +12,15 @@ uniform sampler2D metallicMap;
 uniform sampler2D roughnessMap;
 uniform sampler2D aoMap;
 
-// lights
-uniform vec3 lightPositions[3];
-uniform vec3 lightColors[3];
+// donnees de la frame, communes a tous les dessins (RenderSystem::FrameData, meme disposition)
+layout(std140) uniform FrameData {
+    mat4 viewProj;
+    vec4 camPos;
+    vec4 lightPositions[4]; // FrameData::MAX_LIGHTS
+    vec4 lightColors[4];
+    int lightCount;
+};
 
-uniform vec3 camPos;
 uniform samplerCube cubeMap;
 
 const float PI = 3.14159265359;
@@ -69,8 +73,8 @@ void main() {
     float ao        = texture(aoMap, TexCoords).r;
 
     vec3 N = normalize(normal);
-    vec3 V = normalize(camPos - WorldPos);
-    vec3 I = normalize(WorldPos - camPos);
+    vec3 V = normalize(camPos.xyz - WorldPos);
+    vec3 I = normalize(WorldPos - camPos.xyz);
     vec3 R = reflect(I, N);
 
     vec3 F0 = vec3(0.04);
@@ -78,14 +82,14 @@ void main() {
 
     // reflectance equation
     vec3 Lo = vec3(0.0);
-    for(int i = 0; i < 3; ++i)
+    for(int i = 0; i < lightCount; ++i)
     {
         // calculate per-light radiance
-        vec3 L = normalize(lightPositions[i] - WorldPos);
+        vec3 L = normalize(lightPositions[i].xyz - WorldPos);
         vec3 H = normalize(V + L);
-        float distance    = length(lightPositions[i] - WorldPos);
+        float distance    = length(lightPositions[i].xyz - WorldPos);
         float attenuation = 1.0 / (distance * distance);
-        vec3 radiance     = lightColors[i] * attenuation;
+        vec3 radiance     = lightColors[i].rgb * attenuation;
 
         // cook-torrance brdf
         float NDF = DistributionGGX(N, H, roughness);
@@ -7,11 +7,20 @@ layout (location = 2) in vec3 normal;
 layout (location = 3) in vec2 uv;
 
 // Values that stay constant for the whole mesh.
-uniform mat4 mvp;
+uniform mat4 model;
+
+// donnees de la frame, communes a tous les dessins (RenderSystem::FrameData, meme disposition)
+layout(std140) uniform FrameData {
+    mat4 viewProj;
+    vec4 camPos;
+    vec4 lightPositions[4]; // FrameData::MAX_LIGHTS
+    vec4 lightColors[4];
+    int lightCount;
+};
 
 out vec2 tex_coord;
 
 void main() {
     tex_coord = uv;
-    gl_Position = mvp * vec4(position, 1);
+    gl_Position = viewProj * model * vec4(position, 1);
 }
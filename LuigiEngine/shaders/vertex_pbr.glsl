@@ -4,18 +4,27 @@ layout (location = 0) in vec3 position;
 layout (location = 2) in vec3 normal;
 layout (location = 3) in vec2 uv;
 
-uniform mat4 mvp;
 uniform mat4 model;
 uniform mat3 rotation;
 
+// donnees de la frame, communes a tous les dessins (RenderSystem::FrameData, meme disposition)
+layout(std140) uniform FrameData {
+    mat4 viewProj;
+    vec4 camPos;
+    vec4 lightPositions[4]; // FrameData::MAX_LIGHTS
+    vec4 lightColors[4];
+    int lightCount;
+};
+
 out vec2 TexCoords;
 out vec3 WorldPos;
 out vec3 Normal;
 
 void main() {
     TexCoords = uv;
-    WorldPos = vec3(model * vec4(position, 1));
+    vec4 world = model * vec4(position, 1);
+    WorldPos = vec3(world);
     Normal = vec3(rotation * normal);
 
-    gl_Position = vec4(mvp * vec4(position, 1));
+    gl_Position = viewProj * world;
 }
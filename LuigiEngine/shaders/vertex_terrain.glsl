@@ -7,10 +7,19 @@ layout (location = 2) in vec3 normal;
 layout (location = 3) in vec2 uv;
 
 // Values that stay constant for the whole mesh.
-uniform mat4 mvp;
+uniform mat4 model;
 uniform sampler2D heightmap_tex;
 uniform float multiplier = 0.5;
 
+// donnees de la frame, communes a tous les dessins (RenderSystem::FrameData, meme disposition)
+layout(std140) uniform FrameData {
+    mat4 viewProj;
+    vec4 camPos;
+    vec4 lightPositions[4]; // FrameData::MAX_LIGHTS
+    vec4 lightColors[4];
+    int lightCount;
+};
+
 out vec2 tex_coord;
 out vec3 vtx_position;
 
@@ -18,5 +27,5 @@ void main() {
     tex_coord = uv;
     vtx_position = position;
     vtx_position.y = texture(heightmap_tex, tex_coord).x * multiplier;
-    gl_Position = mvp * vec4(vtx_position, 1);
+    gl_Position = viewProj * model * vec4(vtx_position, 1);
 }
@@ -0,0 +1,594 @@
+// Benchmarks de l'ECS : create / destroy, emplace / remove, tags et entites desactivees, gros composants (Stable), each contre l'Iterator, jointures selon le recouvrement (views, requetes, groupes), tri des storages,
+// mise a jour des hierarchies de Transform (recursive, a plat, en parallele), noyaux de matrices (glm contre TransformMath), copies de Prefab
+// Pas d'appel OpenGL ici : ECS.h, Transform (glm) et Prefab (ses en-tetes incluent GLEW, sans rien appeler)
+// Les resultats sont ecrits en JSON sur la sortie standard (ou dans le fichier passe en argument), avec le nombre de threads
+// du pool et de coeurs de la machine (les chiffres de par_update n'ont de sens qu'avec eux), la progression sur stderr :
+// LuigiEngineBench > resultats.json
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "LuigiEngine/ECS.h"
+#include "LuigiEngine/Prefab.hpp"
+#include "LuigiEngine/ThreadPool.hpp"
+#include "LuigiEngine/Transform.hpp"
+#include "LuigiEngine/TransformMath.hpp"
+
+using namespace std;
+
+// option de Transform.cpp, definie dans LuigiEngine.cpp pour le moteur
+bool* optimizeMVP = new bool(true);
+
+struct Position {
+    float x = 0, y = 0, z = 0;
+};
+
+struct Velocity {
+    float dx = 1, dy = 1, dz = 1;
+};
+
+struct Health {
+    float value = 100;
+};
+
+struct Sleeping {}; //tag : pas de tableau de composants
+
+// gros composant facon MeshComponent, en sparse set et en Stable
+struct Heavy {
+    vector<float> vertices = vector<float>(64);
+    string material = "textures/un/nom/assez/long/pour/allouer";
+};
+
+struct StableHeavy : Heavy {};
+template<> struct StoragePolicy<StableHeavy> { static constexpr StorageMode mode = StorageMode::Stable; };
+
+using Clock = chrono::steady_clock;
+
+struct Result {
+    string name;
+    size_t entities;
+    double overlap; // part des entites qui ont tous les composants de la jointure
+    double ms;
+};
+
+static vector<Result> results;
+static volatile float sink; // empeche le compilateur de supprimer les boucles
+
+static double elapsedMs(Clock::time_point start) {
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+// plus il y a d'entites, moins on repete
+static size_t repeatsFor(size_t count) {
+    return count >= 1000000 ? 3 : count >= 100000 ? 5 : 20;
+}
+
+// meilleur temps sur plusieurs essais, prepare() n'est pas chronometre
+template<typename Prepare, typename Run>
+static double bestOf(size_t repeats, Prepare&& prepare, Run&& run) {
+    double best = 1e300;
+    for (size_t r = 0; r < repeats; r++) {
+        prepare();
+        auto start = Clock::now();
+        run();
+        best = min(best, elapsedMs(start));
+    }
+    return best;
+}
+
+static void record(const string& name, size_t count, double overlap, double ms) {
+    results.push_back({name, count, overlap, ms});
+    fprintf(stderr, "  %-36s %8zu  %5.2f %10.3f ms %10.1f Mops/s\n", name.c_str(), count, overlap, ms, count / (ms * 1000.0));
+}
+
+static void benchCreateDestroy(size_t count) {
+    const size_t repeats = repeatsFor(count);
+    unique_ptr<Registry> registry;
+    vector<Entity> entities(count);
+
+    auto fresh = [&]() { registry = make_unique<Registry>(); };
+    auto populated = [&]() {
+        fresh();
+        registry->create(entities.data(), count);
+        for (Entity e : entities) registry->emplace<Position>(e);
+    };
+
+    record("create", count, 1.0, bestOf(repeats, fresh, [&]() {
+        for (size_t i = 0; i < count; i++) entities[i] = registry->create();
+    }));
+
+    record("create (bulk)", count, 1.0, bestOf(repeats, fresh, [&]() {
+        registry->create(entities.data(), count);
+    }));
+
+    record("destroy", count, 1.0, bestOf(repeats, populated, [&]() {
+        for (Entity e : entities) registry->destroy(e);
+    }));
+
+    record("create (recycle)", count, 1.0, bestOf(repeats, [&]() {
+        populated();
+        for (Entity e : entities) registry->destroy(e);
+    }, [&]() {
+        for (size_t i = 0; i < count; i++) entities[i] = registry->create();
+    }));
+}
+
+static void benchEmplaceRemove(size_t count) {
+    const size_t repeats = repeatsFor(count);
+    unique_ptr<Registry> registry;
+    vector<Entity> entities(count);
+
+    auto empty = [&]() {
+        registry = make_unique<Registry>();
+        registry->create(entities.data(), count);
+    };
+    auto populated = [&]() {
+        empty();
+        for (Entity e : entities) registry->emplace<Position>(e);
+    };
+
+    record("emplace", count, 1.0, bestOf(repeats, empty, [&]() {
+        for (Entity e : entities) registry->emplace<Position>(e);
+    }));
+
+    record("remove", count, 1.0, bestOf(repeats, populated, [&]() {
+        for (Entity e : entities) registry->remove<Position>(e);
+    }));
+
+    populated();
+    size_t found = 0;
+    record("has", count, 1.0, bestOf(repeats, [&]() { found = 0; }, [&]() {
+        for (Entity e : entities) found += registry->has<Position>(e);
+    }));
+
+    // les anciens handles ne doivent plus etre vus comme valides
+    vector<Entity> stale = entities;
+    for (Entity e : stale) registry->destroy(e);
+    registry->create(entities.data(), count);
+    for (Entity e : entities) registry->emplace<Position>(e);
+    size_t accepted = 0;
+    record("has (stale)", count, 1.0, bestOf(repeats, [&]() { accepted = 0; }, [&]() {
+        for (Entity e : stale) accepted += registry->has<Position>(e);
+    }));
+
+    if (found != count || accepted != 0)
+        fprintf(stderr, "  ERREUR : %zu trouves, %zu handles perimes acceptes\n", found, accepted);
+}
+
+// etat marqueur : tag ajoute / enleve contre bit desactive
+static void benchTags(size_t count) {
+    const size_t repeats = repeatsFor(count);
+    unique_ptr<Registry> registry;
+    vector<Entity> entities(count);
+
+    auto populated = [&]() {
+        registry = make_unique<Registry>();
+        registry->create(entities.data(), count);
+        for (Entity e : entities) registry->emplace<Position>(e);
+    };
+    auto tagged = [&]() {
+        populated();
+        for (Entity e : entities) registry->emplace<Sleeping>(e);
+    };
+
+    record("emplace (tag)", count, 1.0, bestOf(repeats, populated, [&]() {
+        for (Entity e : entities) registry->emplace<Sleeping>(e);
+    }));
+
+    record("remove (tag)", count, 1.0, bestOf(repeats, tagged, [&]() {
+        for (Entity e : entities) registry->remove<Sleeping>(e);
+    }));
+
+    record("disable + enable", count, 1.0, bestOf(repeats, populated, [&]() {
+        for (Entity e : entities) registry->disable(e);
+        for (Entity e : entities) registry->enable(e);
+    }));
+
+    // la moitie des entites endormies, par un tag exclu ou par le bitset
+    populated();
+    for (size_t i = 0; i < count; i += 2) registry->emplace<Sleeping>(entities[i]);
+    record("view<1> exclude<tag>.each", count, 0.5, bestOf(repeats, []() {}, [&]() {
+        float sum = 0;
+        registry->view<const Position>(exclude<Sleeping>).each([&](Entity e, const Position& pos) { sum += pos.x; });
+        sink = sum;
+    }));
+
+    populated();
+    for (size_t i = 0; i < count; i += 2) registry->disable(entities[i]);
+    record("view<1>.each (disabled)", count, 0.5, bestOf(repeats, []() {}, [&]() {
+        float sum = 0;
+        registry->view<const Position>().each([&](Entity e, const Position& pos) { sum += pos.x; });
+        sink = sum;
+    }));
+}
+
+// suppression de gros composants : swap-and-pop contre trou sur place, dans un ordre melange
+template<typename Component>
+static void benchHeavyRemove(const string& name, size_t count) {
+    const size_t repeats = repeatsFor(count);
+    unique_ptr<Registry> registry;
+    vector<Entity> entities(count);
+
+    auto populated = [&]() {
+        registry = make_unique<Registry>();
+        registry->create(entities.data(), count);
+        for (Entity e : entities) registry->emplace<Component>(e);
+        shuffle(entities.begin(), entities.end(), mt19937(42));
+    };
+
+    record("emplace " + name, count, 1.0, bestOf(repeats, [&]() {
+        registry = make_unique<Registry>();
+        registry->create(entities.data(), count);
+    }, [&]() {
+        for (Entity e : entities) registry->emplace<Component>(e);
+    }));
+
+    record("remove " + name, count, 1.0, bestOf(repeats, populated, [&]() {
+        for (Entity e : entities) registry->remove<Component>(e);
+    }));
+
+    // la moitie supprimee puis iteration, avant et apres compact
+    populated();
+    for (size_t i = 0; i < count / 2; i++) registry->remove<Component>(entities[i]);
+    auto iterate = [&]() {
+        size_t sum = 0;
+        registry->view<const Component>().each([&](Entity e, const Component& heavy) { sum += heavy.vertices.size(); });
+        sink = float(sum);
+    };
+    record("view<1>.each " + name, count, 0.5, bestOf(repeats, []() {}, iterate));
+    registry->compact();
+    record("view<1>.each compact " + name, count, 0.5, bestOf(repeats, []() {}, iterate));
+}
+
+// jointure dont le second storage a ete rempli dans le desordre, avant et apres sortAs
+static void benchSort(size_t count) {
+    const size_t repeats = repeatsFor(count);
+    auto nothing = []() {};
+    unique_ptr<Registry> registry;
+    vector<Entity> entities(count);
+
+    auto shuffled = [&]() {
+        registry = make_unique<Registry>();
+        registry->create(entities.data(), count);
+        for (Entity e : entities) registry->emplace<Position>(e);
+        vector<Entity> order = entities;
+        shuffle(order.begin(), order.end(), mt19937(42));
+        for (Entity e : order) registry->emplace<Velocity>(e);
+    };
+    auto join = [&]() {
+        registry->view<Position, const Velocity>().each([](Entity e, Position& pos, const Velocity& vel) {
+            pos.x += vel.dx; pos.y += vel.dy; pos.z += vel.dz;
+        });
+    };
+
+    shuffled();
+    record("join<2>.each (shuffled)", count, 1.0, bestOf(repeats, nothing, join));
+
+    record("sortAs", count, 1.0, bestOf(repeats, shuffled, [&]() { registry->sortAs<Velocity, Position>(); }));
+    record("join<2>.each (sorted)", count, 1.0, bestOf(repeats, nothing, join));
+
+    record("sort", count, 1.0, bestOf(repeats, shuffled, [&]() {
+        registry->sort<Velocity>([](Entity a, Entity b) { return entityIndex(a) < entityIndex(b); });
+    }));
+}
+
+// foret de count transforms : des racines de 100 noeuds environ, chaque noeud accroche sous un noeud deja cree de sa racine
+// (profondeur de quelques niveaux), toujours la meme pour un meme count
+static void buildForest(Registry& registry, size_t count, vector<Entity>& entities, vector<Entity>& roots) {
+    entities.resize(count);
+    registry.create(entities.data(), count);
+    roots.clear();
+    mt19937 random(42);
+    size_t rootBegin = 0;
+    for (size_t i = 0; i < count; i++) {
+        registry.emplace<Transform>(entities[i]).setPos({float(i % 7), float(i % 5), float(i % 3)});
+        if (i % 100 == 0) {
+            roots.push_back(entities[i]);
+            rootBegin = i;
+        } else {
+            Entity parent = entities[rootBegin + random() % (i - rootBegin)];
+            registry.emplace<Hierarchy>(entities[i], parent, vector<Entity>{});
+        }
+    }
+}
+
+// le TransformSystem suit les sous-arbres des noeuds signales, ou parcourt tous les niveaux quand beaucoup le sont :
+// deux forets identiques, les memes noeuds bouges, dans la seconde tous les noeuds signales en plus (sans changement).
+// Les deux chemins doivent donner exactement les memes matrices
+static void checkTransformPaths(size_t count) {
+    Registry subtrees, scan;
+    TransformSystem subtreeSystem(subtrees), scanSystem(scan);
+    vector<Entity> subtreeEntities, scanEntities, roots;
+    buildForest(subtrees, count, subtreeEntities, roots);
+    buildForest(scan, count, scanEntities, roots);
+    subtreeSystem.update(subtrees);
+    scanSystem.update(scan);
+
+    size_t mismatches = 0;
+    for (size_t step = 0; step < 4; step++) {
+        auto move = [](Transform& transform) {
+            transform.addPos({0.01f, 0, 0});
+            transform.addEulerRot({0, 5, 0});
+        };
+        for (size_t i = step; i < count; i += 97) {
+            subtrees.patch<Transform>(subtreeEntities[i], move);
+            scan.patch<Transform>(scanEntities[i], move);
+        }
+        for (Entity entity : scanEntities) scan.markChanged<Transform>(entity);
+
+        subtreeSystem.update(subtrees);
+        if (step % 2) scanSystem.par_update(scan, step == 1 ? 64 : 4096);
+        else scanSystem.update(scan);
+
+        for (size_t i = 0; i < count; i++)
+            mismatches += subtrees.get<Transform>(subtreeEntities[i]).globalModel != scan.get<Transform>(scanEntities[i]).globalModel;
+    }
+    if (mismatches) {
+        fprintf(stderr, "transforms : %zu matrices differentes entre les sous-arbres et le parcours complet\n", mismatches);
+        exit(1);
+    }
+}
+
+// Toutes les racines bougent avant chaque essai : toutes les matrices sont recalculees,
+// sauf pour "une racine" (un seul sous-arbre) et "static" (rien n'a bouge : le passage ne doit rien parcourir).
+// par_update a plusieurs tailles de morceaux : trop petits, le decoupage coute plus qu'il ne rapporte, trop gros, peu de threads travaillent
+static void benchTransforms(size_t count) {
+    const size_t repeats = repeatsFor(count);
+    Registry registry;
+    TransformSystem transformSystem(registry);
+
+    vector<Entity> entities, roots;
+    buildForest(registry, count, entities, roots);
+
+    auto moveRoots = [&]() {
+        for (Entity root : roots) registry.patch<Transform>(root, [](Transform& transform) { transform.addPos({0.01f, 0, 0}); });
+    };
+    auto moveOneRoot = [&]() {
+        registry.patch<Transform>(roots[roots.size() / 2], [](Transform& transform) { transform.addPos({0.01f, 0, 0}); });
+    };
+
+    transformSystem.update(registry); // construit la hierarchie a plat
+    record("transforms recursive", count, 1.0, bestOf(repeats, moveRoots, [&]() { transformSystem.updateRecursive(registry); }));
+    record("transforms update", count, 1.0, bestOf(repeats, moveRoots, [&]() { transformSystem.update(registry); }));
+    for (size_t grain : {256, 1024, 4096, 16384}) {
+        record("transforms par_update (grain " + to_string(grain) + ")", count, 1.0,
+               bestOf(repeats, moveRoots, [&]() { transformSystem.par_update(registry, grain); }));
+    }
+    record("transforms update (une racine)", count, 100.0 / count, bestOf(repeats, moveOneRoot, [&]() { transformSystem.update(registry); }));
+    record("transforms update (static)", count, 0.0, bestOf(repeats, []() {}, [&]() { transformSystem.update(registry); }));
+    record("transforms par_update (static)", count, 0.0, bestOf(repeats, []() {}, [&]() { transformSystem.par_update(registry); }));
+    sink = registry.get<Transform>(entities[count - 1]).globalModel[3][0];
+}
+
+// TRS et parent * local sur des tableaux : multiplications 4x4 de glm contre les noyaux de TransformMath
+static void benchMatrices(size_t count) {
+    const size_t repeats = repeatsFor(count);
+    auto nothing = []() {};
+    mt19937 random(42);
+    uniform_real_distribution<float> value(-1.0f, 1.0f);
+
+    vector<vec3> positions(count), scales(count);
+    vector<quat> rotations(count);
+    for (size_t i = 0; i < count; i++) {
+        positions[i] = vec3(value(random), value(random), value(random));
+        scales[i] = vec3(1.0f + value(random) * 0.5f);
+        rotations[i] = normalize(quat(value(random), value(random), value(random), value(random)));
+    }
+    // glm en mat4, les noyaux en mat4x3 (affines, comme dans Transform)
+    vector<size_t> parents(count);
+    for (size_t i = 0; i < count; i++) parents[i] = i % 100 == 0 ? i : i - 1 - random() % (i % 100);
+
+    vector<mat4> locals(count), globals(count);
+    record("trs glm", count, 1.0, bestOf(repeats, nothing, [&]() {
+        for (size_t i = 0; i < count; i++)
+            locals[i] = translate(mat4(1.0f), positions[i]) * toMat4(rotations[i]) * scale(mat4(1.0f), scales[i]);
+    }));
+    record("parent*local glm", count, 1.0, bestOf(repeats, nothing, [&]() {
+        for (size_t i = 0; i < count; i++) globals[i] = parents[i] == i ? locals[i] : locals[parents[i]] * locals[i];
+    }));
+
+    vector<mat4x3> affineLocals(count), affineGlobals(count);
+    vector<const mat4x3*> affineParents(count);
+    for (size_t i = 0; i < count; i++) affineParents[i] = parents[i] == i ? nullptr : &affineLocals[parents[i]];
+    record("trs composeTRS", count, 1.0, bestOf(repeats, nothing, [&]() {
+        composeTRS(positions.data(), rotations.data(), scales.data(), affineLocals.data(), count);
+    }));
+    record("parent*local multiplyAffine", count, 1.0, bestOf(repeats, nothing, [&]() {
+        multiplyAffine(affineParents.data(), affineLocals.data(), affineGlobals.data(), count);
+    }));
+    sink = globals[count - 1][3][0] + affineGlobals[count - 1][3][0];
+}
+
+// count copies d'un sous-arbre de 4 noeuds (racine interpolee, deux enfants, un petit-enfant) dans un registry vide,
+// puis verification des liens parent / enfants et du nombre de composants crees
+static void benchPrefab(size_t count) {
+    if (count > 100000) return; // 4 entites et une Hierarchy par noeud et par copie : plusieurs centaines de Mo au dela
+    const size_t repeats = repeatsFor(count);
+
+    Registry source;
+    Entity root = source.create(), arm = source.create(), hand = source.create(), head = source.create();
+    source.emplace<Transform>(root);
+    source.emplace<PreviousTransform>(root);
+    for (Entity entity : {arm, hand, head}) source.emplace<Transform>(entity).setPos({0, 1, 0});
+    source.emplace<Hierarchy>(arm, root, vector<Entity>{});
+    source.emplace<Hierarchy>(hand, arm, vector<Entity>{});
+    source.emplace<Hierarchy>(head, root, vector<Entity>{});
+    const Prefab prefab(source, root);
+
+    unique_ptr<Registry> registry;
+    vector<Entity> roots;
+    record("prefab instantiate", count * prefab.size(), 1.0, bestOf(repeats, [&]() { registry = make_unique<Registry>(); }, [&]() {
+        roots = prefab.instantiate(*registry, count, [](size_t i, Transform& transform) {
+            transform.setPos({float(i % 100), 0, float(i / 100)});
+        });
+    }));
+
+    // chaque enfant a son parent pour parent, chaque parent liste ses enfants
+    size_t transforms = 0, hierarchies = 0, interpolated = 0, broken = 0;
+    registry->view<const Transform>().each([&](Entity, const Transform&) { transforms++; });
+    registry->view<const PreviousTransform>().each([&](Entity, const PreviousTransform&) { interpolated++; });
+    registry->view<const Hierarchy>().each([&](Entity entity, const Hierarchy& hierarchy) {
+        hierarchies++;
+        for (Entity child : hierarchy.children)
+            broken += !registry->has<Hierarchy>(child) || registry->get<Hierarchy>(child).parent != entity;
+        if (hierarchy.parent != INVALID) {
+            const vector<Entity>& siblings = registry->get<Hierarchy>(hierarchy.parent).children;
+            broken += find(siblings.begin(), siblings.end(), entity) == siblings.end();
+        }
+    });
+    for (Entity copy : roots)
+        broken += registry->get<Hierarchy>(copy).parent != INVALID || registry->get<Hierarchy>(copy).children.size() != 2;
+
+    if (roots.size() != count || transforms != 4 * count || hierarchies != 4 * count || interpolated != count || broken) {
+        fprintf(stderr, "prefab : %zu racines, %zu Transform, %zu Hierarchy, %zu PreviousTransform, %zu liens faux pour %zu copies\n",
+                roots.size(), transforms, hierarchies, interpolated, broken, count);
+        exit(1);
+    }
+}
+
+// chaque entite a une Position, une part overlap a aussi Velocity et Health (choisie au hasard, graine fixe)
+static void populateJoin(Registry& registry, size_t count, double overlap) {
+    vector<Entity> entities(count);
+    registry.create(entities.data(), count);
+    for (Entity e : entities) registry.emplace<Position>(e);
+
+    mt19937 random(42);
+    shuffle(entities.begin(), entities.end(), random);
+    size_t joined = size_t(count * overlap);
+    for (size_t i = 0; i < joined; i++) {
+        registry.emplace<Velocity>(entities[i]);
+        registry.emplace<Health>(entities[i]);
+    }
+}
+
+static void benchIteration(size_t count) {
+    const size_t repeats = repeatsFor(count);
+    auto nothing = []() {};
+
+    Registry registry;
+    populateJoin(registry, count, 1.0);
+
+    record("view<1>.each", count, 1.0, bestOf(repeats, nothing, [&]() {
+        float sum = 0;
+        registry.view<const Position>().each([&](Entity e, const Position& pos) { sum += pos.x; });
+        sink = sum;
+    }));
+
+    record("view<1> iterator", count, 1.0, bestOf(repeats, nothing, [&]() {
+        float sum = 0;
+        auto view = registry.view<const Position>();
+        for (Entity e : view) sum += view.get<const Position>(e).x;
+        sink = sum;
+    }));
+
+    record("view<2>.each", count, 1.0, bestOf(repeats, nothing, [&]() {
+        registry.view<Position, const Velocity>().each([](Entity e, Position& pos, const Velocity& vel) {
+            pos.x += vel.dx; pos.y += vel.dy; pos.z += vel.dz;
+        });
+    }));
+
+    record("view<2> iterator", count, 1.0, bestOf(repeats, nothing, [&]() {
+        auto view = registry.view<Position, const Velocity>();
+        for (Entity e : view) {
+            Position& pos = view.get<Position>(e);
+            const Velocity& vel = view.get<const Velocity>(e);
+            pos.x += vel.dx; pos.y += vel.dy; pos.z += vel.dz;
+        }
+    }));
+}
+
+static void benchJoins(size_t count) {
+    const size_t repeats = repeatsFor(count);
+    auto nothing = []() {};
+
+    for (double overlap : {1.0, 0.5, 0.1, 0.01}) {
+        Registry registry;
+        populateJoin(registry, count, overlap);
+
+        record("join<2>.each", count, overlap, bestOf(repeats, nothing, [&]() {
+            registry.view<Position, const Velocity>().each([](Entity e, Position& pos, const Velocity& vel) {
+                pos.x += vel.dx; pos.y += vel.dy; pos.z += vel.dz;
+            });
+        }));
+
+        record("join<3>.each", count, overlap, bestOf(repeats, nothing, [&]() {
+            registry.view<Position, const Velocity, const Health>().each([](Entity e, Position& pos, const Velocity& vel, const Health& health) {
+                if (health.value > 0) pos.x += vel.dx;
+            });
+        }));
+
+        // Position en excluant Velocity : on parcourt tout le storage de Position
+        record("join<1> exclude<1>.each", count, overlap, bestOf(repeats, nothing, [&]() {
+            float sum = 0;
+            registry.view<const Position>(exclude<Velocity>).each([&](Entity e, const Position& pos) { sum += pos.x; });
+            sink = sum;
+        }));
+
+        // la meme jointure par une requete persistante : ne parcourt que les resultats
+        auto& query = registry.query<Position, const Velocity, const Health>();
+        record("query<3>.each", count, overlap, bestOf(repeats, nothing, [&]() {
+            query.each([](Entity e, Position& pos, const Velocity& vel, const Health& health) {
+                if (health.value > 0) pos.x += vel.dx;
+            });
+        }));
+
+        // la meme jointure par un groupe possedant (cree apres les views, il reordonne les storages)
+        auto& group = registry.group<Position, Velocity>();
+        record("group<2>.each", count, overlap, bestOf(repeats, nothing, [&]() {
+            group.each([](Entity e, Position& pos, Velocity& vel) {
+                pos.x += vel.dx; pos.y += vel.dy; pos.z += vel.dz;
+            });
+        }));
+    }
+}
+
+static void writeJson(FILE* out) {
+    fprintf(out, "{\n  \"benchmark\": \"LuigiEngineBench\",\n  \"unit\": \"ms\",\n");
+    // threads du pool sans le thread appelant, 0 : tout par_update tourne sur le thread appelant
+    fprintf(out, "  \"pool_workers\": %zu,\n  \"hardware_concurrency\": %u,\n  \"results\": [\n",
+            ThreadPool::getInstance().getThreadCount() - 1, thread::hardware_concurrency());
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& result = results[i];
+        fprintf(out, "    {\"name\": \"%s\", \"entities\": %zu, \"overlap\": %.2f, \"ms\": %.4f, \"mops\": %.2f}%s\n",
+                result.name.c_str(), result.entities, result.overlap, result.ms,
+                result.entities / (result.ms * 1000.0), i + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+int main(int argc, char** argv) {
+    fprintf(stderr, "pool : %zu threads en plus du thread appelant, hardware_concurrency : %u\n",
+            ThreadPool::getInstance().getThreadCount() - 1, thread::hardware_concurrency());
+    checkTransformPaths(10000);
+
+    for (size_t count : {1000, 10000, 100000, 1000000}) {
+        fprintf(stderr, "%zu entites\n", count);
+        benchCreateDestroy(count);
+        benchEmplaceRemove(count);
+        benchTags(count);
+        benchHeavyRemove<Heavy>("(heavy)", count);
+        benchHeavyRemove<StableHeavy>("(heavy stable)", count);
+        benchIteration(count);
+        benchJoins(count);
+        benchSort(count);
+        benchTransforms(count);
+        benchMatrices(count);
+        benchPrefab(count);
+    }
+
+    FILE* out = argc > 1 ? fopen(argv[1], "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "impossible d'ouvrir %s\n", argv[1]);
+        return 1;
+    }
+    writeJson(out);
+    if (out != stdout) fclose(out);
+    return 0;
+}